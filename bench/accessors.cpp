@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <jacobs_register_helper.h>
+
+// Built several times at different optimization levels, see CMakeLists.txt
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  l0s_exit_latency, 12, 14,
+  l1_exit_latency, 15, 17,
+  port_number, 24, 31
+);
+
+DECLARE_REGISTER_16_WITH_PERMS(
+    link_control_register,
+    aspm_control, 0, 1, REGISTER_PERMS::READ_WRITE,
+    root_completion_boundary, 3, 3, REGISTER_PERMS::READ,
+    link_disable, 4, 4, REGISTER_PERMS::READ_WRITE,
+    retrain_link, 5, 5, REGISTER_PERMS::READ_WRITE
+)
+
+static constexpr size_t REGISTER_COUNT = 1 << 16;
+static constexpr int ITERATIONS = 200;
+
+#ifndef BENCH_LABEL
+#define BENCH_LABEL "unknown"
+#endif
+
+int main() {
+    std::vector<link_capabilites_register> link_cap_regs(REGISTER_COUNT);
+    std::vector<link_control_register> link_ctrl_regs(REGISTER_COUNT);
+    for (size_t i = 0; i < REGISTER_COUNT; i++) {
+        link_cap_regs[i].set_register_value(static_cast<uint32_t>(i * 2654435761u));
+        link_ctrl_regs[i].set_register_value(static_cast<uint16_t>(i * 40503u));
+    }
+
+    // Raw pointers so -O0 builds measure the accessors rather than std::vector
+    link_capabilites_register *link_cap_data = link_cap_regs.data();
+    link_control_register *link_ctrl_data = link_ctrl_regs.data();
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            link_capabilites_register &link_cap_reg = link_cap_data[i];
+            checksum += link_cap_reg.get_max_link_width() + link_cap_reg.get_aspm_support();
+            link_cap_reg.set_l1_exit_latency(iteration & 0b111);
+
+            link_control_register &link_ctrl_reg = link_ctrl_data[i];
+            checksum += link_ctrl_reg.get_aspm_control();
+            link_ctrl_reg.set_retrain_link(iteration & 0b1);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // 3 gets and 2 sets per register per iteration
+    double operations = 5.0 * REGISTER_COUNT * ITERATIONS;
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("%-24s %6.2f ns/access (checksum %llu)\n",
+        BENCH_LABEL, nanoseconds / operations, static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <chrono>
+#include <memory_resource>
+#include <cstdio>
+#include <optional>
+#include <vector>
+#include <jacobs_register_archive.h>
+#include <jacobs_register_query.h>
+#include <jacobs_register_snapshot.h>
+
+// Analysis over a large synthetic archive of captured link capabilities,
+// shaped like a fleet: few distinct widths and speeds, many port numbers
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  l0s_exit_latency, 12, 14,
+  l1_exit_latency, 15, 17,
+  port_number, 24, 31
+);
+
+static constexpr size_t REGISTER_COUNT = 1 << 23;
+
+template <typename BODY>
+static double time_ms(BODY body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main() {
+    std::vector<link_capabilites_register> archive(REGISTER_COUNT);
+    uint64_t state = 0x9E37'79B9'7F4A'7C15;
+    for (size_t i = 0; i < REGISTER_COUNT; i++) {
+        link_capabilites_register &reg = archive[i];
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint32_t random = static_cast<uint32_t>(state >> 32);
+        reg.set_max_link_speed(1 + random % 5);
+        reg.set_max_link_width(1u << (random >> 8) % 5);
+        reg.set_aspm_support((random >> 12) & 0b11);
+        reg.set_port_number((random >> 16) & 0xFF);
+        // A rarely set value, one in a million registers
+        reg.set_l1_exit_latency(i % 1'000'000 == 1234 ? 0b111 : 0b000);
+    }
+    std::printf("%zu registers\n", REGISTER_COUNT);
+
+    constexpr register_field_info port_number = register_field<link_capabilites_register>("port_number");
+    constexpr register_field_info max_link_width = register_field<link_capabilites_register>("max_link_width");
+
+    for (const register_field_info &field : {port_number, max_link_width}) {
+        std::vector<uint32_t> radix;
+        double radix_ms = time_ms([&] { radix = sort_permutation_by_field(archive.data(), REGISTER_COUNT, field); });
+
+        std::vector<uint32_t> comparison(REGISTER_COUNT);
+        double comparison_ms = time_ms([&] {
+            for (size_t i = 0; i < REGISTER_COUNT; i++) {
+                comparison[i] = static_cast<uint32_t>(i);
+            }
+            std::stable_sort(comparison.begin(), comparison.end(), [&](uint32_t lhs, uint32_t rhs) {
+                return get_field_value(archive[lhs].get_register_value(), field) <
+                    get_field_value(archive[rhs].get_register_value(), field);
+            });
+        });
+
+        std::printf("sort by %-16s radix %8.1f ms, std::stable_sort %8.1f ms%s\n", field.name,
+            radix_ms, comparison_ms, radix == comparison ? "" : " MISMATCH");
+    }
+
+    register_field_index index;
+    double index_ms = time_ms([&] { index = build_field_index(archive.data(), REGISTER_COUNT, max_link_width); });
+    std::printf("index by %-15s %8.1f ms, %zu groups\n", max_link_width.name, index_ms, index.groups.size());
+
+    // Ports with L1 supported and a link speed below 3, by scan and by bitmaps
+    constexpr register_field_info aspm_support = register_field<link_capabilites_register>("aspm_support");
+    constexpr register_field_info max_link_speed = register_field<link_capabilites_register>("max_link_speed");
+    std::vector<uint32_t> scanned;
+    double scan_ms = time_ms([&] {
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            if (archive[i].get_aspm_support() >= 0b10 && archive[i].get_max_link_speed() < 3) {
+                scanned.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    });
+    std::optional<register_bitmap_index> aspm_index;
+    std::optional<register_bitmap_index> speed_index;
+    double bitmap_build_ms = time_ms([&] {
+        aspm_index.emplace(archive.data(), REGISTER_COUNT, aspm_support);
+        speed_index.emplace(archive.data(), REGISTER_COUNT, max_link_speed);
+    });
+    register_bitmap matches;
+    double bitmap_ms = time_ms([&] { matches = aspm_index->in({0b10, 0b11}) & speed_index->range(0, 2); });
+    std::printf("L1 and speed < 3: scan %8.1f ms, bitmaps %8.1f ms (build %.1f ms, %.1f MB), %zu matches%s\n",
+        scan_ms, bitmap_ms, bitmap_build_ms, (aspm_index->size_in_bytes() + speed_index->size_in_bytes()) / 1e6,
+        matches.cardinality(), matches.to_rows() == scanned ? "" : " MISMATCH");
+
+    // The same query through the filter engine over a memory mapped copy
+    const char *path = "archive_bench.bin";
+    register_mapped_archive<link_capabilites_register> mapped;
+    if (!write_register_archive(path, archive.data(), REGISTER_COUNT) || !mapped.open(path)) {
+        std::printf("could not write %s\n", path);
+        return 1;
+    }
+    register_predicate predicate = field_in(aspm_support, {0b10, 0b11}) & field_less(max_link_speed, 3);
+    for (unsigned threads : {1u, 0u}) {
+        register_query<link_capabilites_register> query(mapped.data(), mapped.size(), threads);
+        size_t count = 0;
+        std::vector<size_t> rows;
+        double count_ms = time_ms([&] { count = query.count_matches(predicate); });
+        double select_ms = time_ms([&] { rows = query.select(predicate); });
+        bool same = count == scanned.size() && std::equal(rows.begin(), rows.end(), scanned.begin(), scanned.end());
+        std::printf("query on %2u threads: count %8.1f ms, select %8.1f ms%s\n",
+            threads != 0 ? threads : std::thread::hardware_concurrency(), count_ms, select_ms, same ? "" : " MISMATCH");
+    }
+
+    // A rare value with and without a zone map to skip chunks
+    constexpr register_field_info l1_exit_latency = register_field<link_capabilites_register>("l1_exit_latency");
+    register_zone_map<link_capabilites_register> zones;
+    double zone_build_ms = time_ms([&] { zones.append(mapped.data(), mapped.size()); });
+    register_predicate rare = field_equal(l1_exit_latency, 0b111);
+    register_query<link_capabilites_register> full_scan(mapped.data(), mapped.size(), 1);
+    register_query<link_capabilites_register> zoned(mapped.data(), mapped.size(), 1, &zones);
+    size_t full_count = 0;
+    size_t zoned_count = 0;
+    double full_ms = time_ms([&] { full_count = full_scan.count_matches(rare); });
+    double zoned_ms = time_ms([&] { zoned_count = zoned.count_matches(rare); });
+    std::printf("rare l1_exit_latency: scan %8.2f ms, zone map %8.2f ms (build %.1f ms, %zu chunks), %zu matches%s\n",
+        full_ms, zoned_ms, zone_build_ms, zones.chunk_count(), zoned_count, full_count == zoned_count ? "" : " MISMATCH");
+
+    // The L1 query again on a dictionary encoded copy
+    std::optional<register_dictionary_archive<link_capabilites_register>> encoded;
+    double encode_ms = time_ms([&] { encoded.emplace(mapped.data(), mapped.size()); });
+    size_t encoded_count = 0;
+    std::vector<size_t> encoded_rows;
+    double encoded_count_ms = time_ms([&] { encoded_count = encoded->count_matches(predicate); });
+    double encoded_select_ms = time_ms([&] { encoded_rows = encoded->select(predicate); });
+    bool same = encoded_count == scanned.size() &&
+        std::equal(encoded_rows.begin(), encoded_rows.end(), scanned.begin(), scanned.end());
+    std::printf("dictionary: %zu entries, %u bit codes, %.1f MB vs %.1f MB (encode %.1f ms), count %.2f ms, select %.1f ms%s\n",
+        encoded->dictionary().size(), encoded->code_width(), encoded->size_in_bytes() / 1e6,
+        REGISTER_COUNT * sizeof(uint32_t) / 1e6, encode_ms, encoded_count_ms, encoded_select_ms, same ? "" : " MISMATCH");
+
+    // A report's worth of per device snapshots with an occasional diff, from
+    // the heap and from an arena released in one go
+    constexpr size_t DEVICE_REGISTERS = 8;
+    for (bool arena : {false, true}) {
+        size_t changes_found = 0;
+        double report_ms = time_ms([&] {
+            std::pmr::monotonic_buffer_resource report_arena;
+            std::pmr::memory_resource *resource = arena ? &report_arena : std::pmr::get_default_resource();
+            register_snapshot_store<link_capabilites_register> snapshots(resource);
+            std::pmr::vector<register_field_change<link_capabilites_register>> changes(resource);
+            uint64_t previous = snapshots.put(archive.data(), DEVICE_REGISTERS);
+            for (size_t device = 1; device < REGISTER_COUNT / DEVICE_REGISTERS; device++) {
+                uint64_t key = snapshots.put(archive.data() + device * DEVICE_REGISTERS, DEVICE_REGISTERS);
+                if (device % 64 == 0) {
+                    snapshots.diff(previous, key, changes);
+                }
+                previous = key;
+            }
+            changes_found = changes.size();
+        });
+        std::printf("snapshot report %-5s %8.1f ms, %zu changes\n", arena ? "arena" : "heap", report_ms, changes_found);
+    }
+    mapped.close();
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Small benchmark harness shared by the benchmarks in this folder. Each
+// benchmark reports wall clock time and, where perf_event_open is permitted,
+// hardware counters per operation. Results can be written as JSON and compared
+// against a previous run.
+
+enum class BENCH_COUNTER {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    COUNT
+};
+
+static const char *const bench_counter_names[] = {
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "l1d_misses",
+    "llc_misses"
+};
+
+static constexpr size_t BENCH_COUNTER_COUNT = static_cast<size_t>(BENCH_COUNTER::COUNT);
+
+// Opens the counters as one perf event group, so they are scheduled onto the
+// PMU together and their ratios are consistent. Counts are scaled by the time
+// the group was enabled over the time it actually ran, in case the kernel
+// multiplexed it with other events. Counters the kernel refuses (no PMU in a
+// VM, perf_event_paranoid, seccomp) are simply reported as unavailable.
+class bench_counters {
+    public:
+        bench_counters() {
+#if defined(__linux__)
+            for (size_t i = 0; i < BENCH_COUNTER_COUNT; i++) {
+                descriptors[i] = open_counter(static_cast<BENCH_COUNTER>(i), leader);
+                if (leader < 0) {
+                    leader = descriptors[i];
+                }
+            }
+#endif
+        }
+
+        ~bench_counters() {
+#if defined(__linux__)
+            for (int descriptor : descriptors) {
+                if (descriptor >= 0) {
+                    close(descriptor);
+                }
+            }
+#endif
+        }
+
+        bench_counters(const bench_counters &) = delete;
+        bench_counters &operator=(const bench_counters &) = delete;
+
+        bool available(BENCH_COUNTER counter) const {
+            return descriptors[static_cast<size_t>(counter)] >= 0;
+        }
+
+        bool any_available() const {
+            for (int descriptor : descriptors) {
+                if (descriptor >= 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void start() {
+#if defined(__linux__)
+            if (leader >= 0) {
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+#endif
+        }
+
+        void stop(uint64_t (&values)[BENCH_COUNTER_COUNT]) {
+            for (uint64_t &value : values) {
+                value = 0;
+            }
+#if defined(__linux__)
+            if (leader < 0) {
+                return;
+            }
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            // PERF_FORMAT_GROUP layout: count, time enabled, time running,
+            // then one value per event in the order they joined the group
+            uint64_t group[3 + BENCH_COUNTER_COUNT];
+            ssize_t bytes = read(leader, group, sizeof(group));
+            if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t)) || group[2] == 0) {
+                return;
+            }
+            double scale = static_cast<double>(group[1]) / static_cast<double>(group[2]);
+            size_t member = 0;
+            for (size_t i = 0; i < BENCH_COUNTER_COUNT; i++) {
+                if (descriptors[i] >= 0 && member < group[0]) {
+                    values[i] = static_cast<uint64_t>(static_cast<double>(group[3 + member]) * scale);
+                    member++;
+                }
+            }
+#endif
+        }
+
+    private:
+#if defined(__linux__)
+        // The first counter opened leads the group and starts disabled, the
+        // others follow it
+        static int open_counter(BENCH_COUNTER counter, int group) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = group < 0;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            switch (counter) {
+                case BENCH_COUNTER::CYCLES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case BENCH_COUNTER::INSTRUCTIONS:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case BENCH_COUNTER::BRANCH_MISSES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                    break;
+                case BENCH_COUNTER::L1D_MISSES:
+                    attr.type = PERF_TYPE_HW_CACHE;
+                    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                    break;
+                case BENCH_COUNTER::LLC_MISSES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                    break;
+                default:
+                    return -1;
+            }
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+        }
+#endif
+
+        int descriptors[BENCH_COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+        int leader = -1;
+};
+
+// Per operation numbers for one benchmark, counters that were unavailable are NaN
+struct bench_result {
+    std::string name;
+    double ns_per_op = 0.0;
+    double counters_per_op[BENCH_COUNTER_COUNT];
+};
+
+class bench_harness {
+    public:
+        // Runs body() once to warm up, then times it. body() must perform
+        // operations operations and return something derived from them so the
+        // work cannot be optimised away.
+        template <typename BODY>
+        void run(const char *name, uint64_t operations, BODY body) {
+            volatile uint64_t sink = body();
+
+            uint64_t values[BENCH_COUNTER_COUNT];
+            auto start = std::chrono::steady_clock::now();
+            counters.start();
+            sink = sink + body();
+            counters.stop(values);
+            auto end = std::chrono::steady_clock::now();
+
+            bench_result result;
+            result.name = name;
+            result.ns_per_op = std::chrono::duration<double, std::nano>(end - start).count() / operations;
+            for (size_t i = 0; i < BENCH_COUNTER_COUNT; i++) {
+                result.counters_per_op[i] = counters.available(static_cast<BENCH_COUNTER>(i)) ?
+                    static_cast<double>(values[i]) / operations : NAN;
+            }
+            print(result);
+            results.push_back(result);
+        }
+
+        void print_header() const {
+            std::printf("%-28s %10s", "benchmark", "ns/op");
+            for (const char *counter : bench_counter_names) {
+                std::printf(" %14s", counter);
+            }
+            std::printf("\n");
+            if (!counters.any_available()) {
+                std::printf("(hardware counters unavailable, check /proc/sys/kernel/perf_event_paranoid)\n");
+            }
+        }
+
+        bool write_json(const char *path) const {
+            std::ofstream file(path);
+            if (!file) {
+                return false;
+            }
+            file << "[\n";
+            for (size_t i = 0; i < results.size(); i++) {
+                const bench_result &result = results[i];
+                file << "  {\"name\": \"" << result.name << "\", \"ns_per_op\": " << result.ns_per_op;
+                for (size_t j = 0; j < BENCH_COUNTER_COUNT; j++) {
+                    file << ", \"" << bench_counter_names[j] << "\": ";
+                    if (std::isnan(result.counters_per_op[j])) {
+                        file << "null";
+                    } else {
+                        file << result.counters_per_op[j];
+                    }
+                }
+                file << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+            }
+            file << "]\n";
+            return static_cast<bool>(file);
+        }
+
+        // Compares against a file written by write_json(). Instructions per
+        // operation are stable enough to gate on, so a growth beyond threshold
+        // there counts as a regression, the other numbers are informational.
+        // Returns the number of regressions, or 1 if the baseline can't be
+        // read or holds no results, so a misnamed baseline fails the gate.
+        int compare_json(const char *path, double threshold) const {
+            std::vector<bench_result> baseline;
+            if (!read_json(path, baseline) || baseline.empty()) {
+                std::printf("could not read baseline %s\n", path);
+                return 1;
+            }
+            int regressions = 0;
+            std::printf("\n%-28s %16s %22s\n", "compared to baseline", "ns/op", "instructions/op");
+            for (const bench_result &result : results) {
+                const bench_result *previous = nullptr;
+                for (const bench_result &candidate : baseline) {
+                    if (candidate.name == result.name) {
+                        previous = &candidate;
+                    }
+                }
+                if (previous == nullptr) {
+                    std::printf("%-28s %16s\n", result.name.c_str(), "new");
+                    continue;
+                }
+                size_t instructions = static_cast<size_t>(BENCH_COUNTER::INSTRUCTIONS);
+                double time_change = relative_change(previous->ns_per_op, result.ns_per_op);
+                double instruction_change = relative_change(
+                    previous->counters_per_op[instructions], result.counters_per_op[instructions]);
+                bool regressed = !std::isnan(instruction_change) && instruction_change > threshold;
+                regressions += regressed;
+                std::printf("%-28s ", result.name.c_str());
+                print_change(time_change, 16);
+                std::printf(" ");
+                print_change(instruction_change, 22);
+                std::printf("%s\n", regressed ? "  REGRESSION" : "");
+            }
+            return regressions;
+        }
+
+    private:
+        static double relative_change(double before, double after) {
+            if (std::isnan(before) || std::isnan(after) || before == 0.0) {
+                return NAN;
+            }
+            return (after - before) / before;
+        }
+
+        static void print_change(double change, int width) {
+            if (std::isnan(change)) {
+                std::printf("%*s", width, "-");
+            } else {
+                std::printf("%+*.1f%%", width - 1, change * 100);
+            }
+        }
+
+        static void print(const bench_result &result) {
+            std::printf("%-28s %10.3f", result.name.c_str(), result.ns_per_op);
+            for (double value : result.counters_per_op) {
+                if (std::isnan(value)) {
+                    std::printf(" %14s", "-");
+                } else {
+                    std::printf(" %14.3f", value);
+                }
+            }
+            std::printf("\n");
+        }
+
+        // Only understands the one object per line layout write_json() produces
+        static bool read_json(const char *path, std::vector<bench_result> &out) {
+            std::ifstream file(path);
+            if (!file) {
+                return false;
+            }
+            std::string line;
+            while (std::getline(file, line)) {
+                bench_result result;
+                if (!read_string(line, "name", result.name)) {
+                    continue;
+                }
+                result.ns_per_op = read_number(line, "ns_per_op");
+                for (size_t i = 0; i < BENCH_COUNTER_COUNT; i++) {
+                    result.counters_per_op[i] = read_number(line, bench_counter_names[i]);
+                }
+                out.push_back(result);
+            }
+            return true;
+        }
+
+        static bool read_string(const std::string &line, const char *key, std::string &value) {
+            std::string pattern = std::string("\"") + key + "\": \"";
+            size_t start = line.find(pattern);
+            if (start == std::string::npos) {
+                return false;
+            }
+            start += pattern.size();
+            size_t end = line.find('"', start);
+            if (end == std::string::npos) {
+                return false;
+            }
+            value = line.substr(start, end - start);
+            return true;
+        }
+
+        static double read_number(const std::string &line, const char *key) {
+            std::string pattern = std::string("\"") + key + "\": ";
+            size_t start = line.find(pattern);
+            if (start == std::string::npos) {
+                return NAN;
+            }
+            std::istringstream stream(line.substr(start + pattern.size()));
+            double value;
+            if (!(stream >> value)) {
+                return NAN;
+            }
+            return value;
+        }
+
+        bench_counters counters;
+        std::vector<bench_result> results;
+};
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <jacobs_register_helper.h>
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  port_number, 24, 31
+);
+
+DECLARE_REGISTER_16(
+  link_status_register,
+  current_link_speed, 0, 3,
+  negotiated_link_width, 4, 9,
+  link_training, 11, 11
+);
+
+// Each record is a 5 bit tag followed by a 32 bit and a 16 bit register, so
+// records straddle byte boundaries at every possible offset
+static constexpr size_t RECORD_COUNT = 1 << 24;
+static constexpr size_t RECORD_BITS = 5 + 32 + 16;
+
+int main() {
+    std::vector<uint8_t> stream((RECORD_COUNT * RECORD_BITS + 7) / 8);
+
+    uint64_t state = 0x9E37'79B9'7F4A'7C15;
+    uint64_t written_checksum = 0;
+    register_bit_writer writer(stream.data(), stream.size());
+    for (size_t i = 0; i < RECORD_COUNT; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        link_capabilites_register link_cap_reg;
+        link_status_register link_status_reg;
+        link_cap_reg.set_register_value(static_cast<uint32_t>(state >> 32));
+        link_status_reg.set_register_value(static_cast<uint16_t>(state >> 16));
+        writer.write_bits(i & 0x1F, 5);
+        writer.write(link_cap_reg);
+        writer.write(link_status_reg);
+        written_checksum += link_cap_reg.get_port_number() + link_status_reg.get_negotiated_link_width();
+    }
+    writer.flush();
+
+    uint64_t read_checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    register_bit_reader reader(stream.data(), stream.size());
+    link_capabilites_register link_cap_reg;
+    link_status_register link_status_reg;
+    uint64_t tag;
+    while (reader.read_bits(5, tag) && reader.read(link_cap_reg) && reader.read(link_status_reg)) {
+        read_checksum += link_cap_reg.get_port_number() + link_status_reg.get_negotiated_link_width();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (read_checksum != written_checksum) {
+        std::printf("checksum mismatch: wrote %llu, read %llu\n",
+            static_cast<unsigned long long>(written_checksum), static_cast<unsigned long long>(read_checksum));
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::printf("read %zu records (%zu bytes) in %.3f s\n", RECORD_COUNT, stream.size(), seconds);
+    std::printf("%.1f Mrecords/s, %.2f GB/s\n", RECORD_COUNT / seconds / 1e6, stream.size() / seconds / 1e9);
+    return 0;
+}
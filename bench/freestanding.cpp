@@ -0,0 +1,67 @@
+#include <jacobs_register_helper.h>
+
+// Built with -ffreestanding -fno-exceptions -fno-rtti -nostdlib to check the
+// header never needs the hosted library, and to measure a minimal image. There
+// is no libc here, so this provides its own entry point.
+
+// Headers the target's CRC instructions might drag in reach the C library's
+// <stdlib.h>, which still compiles under -ffreestanding, so check explicitly
+#if defined(_STDLIB_H) || defined(_GLIBCXX_CSTDLIB)
+#error "jacobs_register_helper.h included the hosted C library"
+#endif
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  port_number, 24, 31
+);
+
+DECLARE_REGISTER_16_WITH_PERMS(
+    link_control_register,
+    aspm_control, 0, 1, REGISTER_PERMS::READ_WRITE,
+    root_completion_boundary, 3, 3, REGISTER_PERMS::READ,
+    link_disable, 4, 4, REGISTER_PERMS::READ_WRITE
+)
+
+DECLARE_REGISTER_32(
+  link_capabilites_register_rev2,
+  port_number, 0, 7,
+  max_link_speed, 8, 11,
+  max_link_width, 12, 17,
+  aspm_support, 18, 19
+);
+
+// Stand ins for MMIO
+volatile uint32_t link_capabilities_mmio = 0xDEAD'BEEF;
+volatile uint16_t link_control_mmio = 0x0;
+volatile uint32_t link_capabilities_rev2_mmio = 0x0;
+char boot_log[64];
+volatile uint32_t boot_fingerprint = 0x0;
+
+extern "C" [[noreturn]] void _start() {
+    link_capabilites_register link_cap_reg;
+    link_cap_reg.set_register_value(link_capabilities_mmio);
+
+    link_control_register link_ctrl_reg;
+    link_ctrl_reg.set_aspm_control(link_cap_reg.get_aspm_support());
+    link_control_mmio = link_ctrl_reg.get_register_value();
+
+    link_capabilities_rev2_mmio =
+        transcode<link_capabilites_register, link_capabilites_register_rev2>(link_cap_reg).get_register_value();
+
+    uint8_t stream[8] = {};
+    register_bit_writer writer(stream, sizeof(stream));
+    writer.write(link_ctrl_reg);
+    writer.flush();
+
+    format_register(link_cap_reg, boot_log, sizeof(boot_log));
+
+    register_fingerprinted_block<link_capabilites_register, 4> ports;
+    ports.set(2, link_cap_reg);
+    boot_fingerprint = ports.fingerprint();
+
+    while (true) {
+    }
+}
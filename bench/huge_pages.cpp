@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <sys/mman.h>
+#include <jacobs_register_memory.h>
+
+// A field extraction over a large register array, and a random gather from
+// it, with the array on 4 KB pages and on huge pages.
+//
+//   huge_pages_bench [size in MB, default 1024]
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  l0s_exit_latency, 12, 14,
+  l1_exit_latency, 15, 17,
+  port_number, 24, 31
+);
+
+// Plain anonymous mappings with transparent huge pages turned off, so the
+// baseline stays on 4 KB pages whatever the system's THP setting
+class small_page_resource : public std::pmr::memory_resource {
+    private:
+        void *do_allocate(size_t bytes, size_t) override {
+            void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            madvise(memory, bytes, MADV_NOHUGEPAGE);
+            return memory;
+        }
+
+        void do_deallocate(void *memory, size_t bytes, size_t) override {
+            munmap(memory, bytes);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+};
+
+template <typename BODY>
+static double time_ms(BODY body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void run(const char *name, std::pmr::memory_resource *resource, size_t count) {
+    double fill_ms = 0.0;
+    double extract_ms = 0.0;
+    double gather_ms = 0.0;
+    uint64_t sum = 0;
+    {
+        std::pmr::vector<link_capabilites_register> regs(resource);
+        fill_ms = time_ms([&] {
+            regs.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                regs[i].set_register_value(static_cast<uint32_t>(i * 2654435761u));
+            }
+        });
+        extract_ms = time_ms([&] {
+            for (const link_capabilites_register &reg : regs) {
+                sum += reg.get_max_link_width();
+            }
+        });
+        gather_ms = time_ms([&] {
+            uint64_t state = 0x9E37'79B9'7F4A'7C15;
+            for (size_t i = 0; i < count / 16; i++) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                sum += regs[(state >> 20) % count].get_port_number();
+            }
+        });
+    }
+    std::printf("%-12s fill %8.1f ms, extract %8.1f ms, random gather %8.1f ms (%llu)\n",
+        name, fill_ms, extract_ms, gather_ms, static_cast<unsigned long long>(sum & 0xFF));
+}
+
+int main(int argc, char *argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    size_t count = (megabytes << 20) / sizeof(link_capabilites_register);
+    std::printf("%zu MB, %zu registers\n", megabytes, count);
+
+    small_page_resource small_pages;
+    run("4 KB pages", &small_pages, count);
+
+    register_huge_page_resource huge_pages;
+    run("huge pages", &huge_pages, count);
+    std::printf("huge page mappings: %zu explicit (MAP_HUGETLB), %zu transparent (madvise)\n",
+        huge_pages.explicit_allocations(), huge_pages.transparent_allocations());
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <jacobs_register_helper.h>
+
+// IPv4 and TCP header words, numbered as in RFC 791 and RFC 9293
+DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(
+  ipv4_header_word_0,
+  MSB0,
+  version, 0, 3,
+  ihl, 4, 7,
+  dscp, 8, 13,
+  ecn, 14, 15,
+  total_length, 16, 31
+);
+
+DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(
+  ipv4_header_word_1,
+  MSB0,
+  identification, 0, 15,
+  flags, 16, 18,
+  fragment_offset, 19, 31
+);
+
+DECLARE_REGISTER_16_BIG_ENDIAN_VIEW_WITH_NUMBERING(
+  tcp_header_offset_flags,
+  MSB0,
+  data_offset, 0, 3,
+  reserved, 4, 7,
+  flags, 8, 15
+);
+
+// pcap record header followed by ethernet, IPv4 and TCP headers
+static constexpr size_t RECORD_HEADER_SIZE = 16;
+static constexpr size_t ETHERNET_HEADER_SIZE = 14;
+static constexpr size_t PACKET_SIZE = ETHERNET_HEADER_SIZE + 20 + 20;
+static constexpr size_t PACKET_COUNT = 1 << 20;
+static constexpr int ITERATIONS = 20;
+
+static std::vector<uint8_t> build_capture() {
+    std::vector<uint8_t> capture;
+    capture.reserve(PACKET_COUNT * (RECORD_HEADER_SIZE + PACKET_SIZE));
+    for (size_t i = 0; i < PACKET_COUNT; i++) {
+        uint8_t record[RECORD_HEADER_SIZE + PACKET_SIZE] = {};
+        uint32_t length = PACKET_SIZE;
+        std::memcpy(record + 8, &length, sizeof(length));
+        std::memcpy(record + 12, &length, sizeof(length));
+
+        uint8_t *ip = record + RECORD_HEADER_SIZE + ETHERNET_HEADER_SIZE;
+        ipv4_header_word_0 word_0(ip);
+        word_0.set_version(4);
+        word_0.set_ihl(5);
+        word_0.set_total_length(40);
+        ipv4_header_word_1 word_1(ip + 4);
+        word_1.set_identification(i & 0xFFFF);
+        word_1.set_flags(i % 3 == 0 ? 0b010 : 0b001);
+        word_1.set_fragment_offset(i & 0x1FFF);
+
+        tcp_header_offset_flags tcp(ip + 20 + 12);
+        tcp.set_data_offset(5);
+        tcp.set_flags(i & 0xFF);
+
+        capture.insert(capture.end(), record, record + sizeof(record));
+    }
+    return capture;
+}
+
+int main() {
+    std::vector<uint8_t> capture = build_capture();
+
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        size_t offset = 0;
+        while (offset + RECORD_HEADER_SIZE <= capture.size()) {
+            uint32_t length;
+            std::memcpy(&length, capture.data() + offset + 8, sizeof(length));
+            uint8_t *ip = capture.data() + offset + RECORD_HEADER_SIZE + ETHERNET_HEADER_SIZE;
+
+            ipv4_header_word_0 word_0(ip);
+            ipv4_header_word_1 word_1(ip + 4);
+            tcp_header_offset_flags tcp(ip + word_0.get_ihl() * 4 + 12);
+            checksum += word_0.get_total_length();
+            checksum += word_1.get_fragment_offset();
+            checksum += word_1.get_flags() & 0b001;
+            checksum += tcp.get_flags() & 0x02;
+            checksum += tcp.get_data_offset();
+
+            offset += RECORD_HEADER_SIZE + length;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double packets = static_cast<double>(PACKET_COUNT) * ITERATIONS;
+    double bytes = static_cast<double>(capture.size()) * ITERATIONS;
+    std::printf("parsed %.0f packets in %.3f s\n", packets, seconds);
+    std::printf("%.1f Mpps, %.2f GB/s (checksum %llu)\n",
+        packets / seconds / 1e6, bytes / seconds / 1e9, static_cast<unsigned long long>(checksum));
+    return 0;
+}
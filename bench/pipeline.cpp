@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <jacobs_register_pipeline.h>
+
+// Sustained throughput of the snapshot pipeline, fed through a pipe by a
+// producer thread like a live stream would be
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  l0s_exit_latency, 12, 14,
+  l1_exit_latency, 15, 17,
+  port_number, 24, 31
+);
+
+static constexpr size_t REGISTERS_PER_RECORD = 32;
+static constexpr size_t RECORD_COUNT = 1 << 20;
+
+int main() {
+    int stream_pipe[2];
+    if (pipe(stream_pipe) != 0) {
+        std::printf("could not create a pipe\n");
+        return 1;
+    }
+    std::thread producer([&stream_pipe] {
+        std::vector<uint32_t> chunk(REGISTERS_PER_RECORD * 256);
+        bool failed = false;
+        for (size_t record = 0; record < RECORD_COUNT && !failed; record += 256) {
+            for (size_t i = 0; i < chunk.size(); i++) {
+                chunk[i] = static_cast<uint32_t>((record * REGISTERS_PER_RECORD + i) * 2654435761u);
+            }
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(chunk.data());
+            size_t size = chunk.size() * sizeof(uint32_t);
+            for (size_t written = 0; written < size && !failed;) {
+                ssize_t result = write(stream_pipe[1], bytes + written, size - written);
+                failed = result <= 0;
+                written += failed ? 0 : static_cast<size_t>(result);
+            }
+        }
+        // Closing on failure too, the pipeline only stops at end of stream
+        close(stream_pipe[1]);
+    });
+
+    register_snapshot_pipeline<link_capabilites_register> pipeline(REGISTERS_PER_RECORD);
+    uint64_t l1_ports = 0;
+    uint64_t width_sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    register_pipeline_stats stats = pipeline.run(stream_pipe[0],
+        [&l1_ports](link_capabilites_register *record, size_t registers) {
+            for (size_t i = 0; i < registers; i++) {
+                l1_ports += record[i].get_aspm_support() >= 0b10;
+            }
+        },
+        [&width_sum](const link_capabilites_register *record, size_t registers) {
+            for (size_t i = 0; i < registers; i++) {
+                width_sum += record[i].get_max_link_width();
+            }
+        });
+    auto end = std::chrono::steady_clock::now();
+    producer.join();
+    close(stream_pipe[0]);
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::printf("%zu records in %zu batches, %.1f MB in %.1f ms: %.2f GB/s, %.1f M records/s on %u hardware threads\n",
+        stats.records, stats.batches, stats.bytes / 1e6, seconds * 1e3, stats.bytes / seconds / 1e9,
+        stats.records / seconds / 1e6, std::thread::hardware_concurrency());
+    std::printf("%llu l1 ports, width sum %llu\n", static_cast<unsigned long long>(l1_ports),
+        static_cast<unsigned long long>(width_sum));
+    return stats.records == RECORD_COUNT ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <jacobs_register_helper.h>
+#include "bench_harness.h"
+
+// Per operation cost of the main register code paths.
+//
+//   register_ops_bench [--output results.json] [--baseline previous.json] [--threshold 0.05]
+//
+// With --baseline the run is compared against a previous --output file and the
+// exit status is non zero if instructions per operation grew by more than the
+// threshold on any benchmark, or if the baseline can't be read.
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  l0s_exit_latency, 12, 14,
+  l1_exit_latency, 15, 17,
+  port_number, 24, 31
+);
+
+DECLARE_REGISTER_32(
+  link_capabilites_register_rev2,
+  port_number, 0, 7,
+  max_link_speed, 8, 11,
+  max_link_width, 12, 17,
+  aspm_support, 18, 19
+);
+
+DECLARE_REGISTER_16_WITH_PERMS(
+    link_control_register,
+    aspm_control, 0, 1, REGISTER_PERMS::READ_WRITE,
+    root_completion_boundary, 3, 3, REGISTER_PERMS::READ,
+    link_disable, 4, 4, REGISTER_PERMS::READ_WRITE,
+    retrain_link, 5, 5, REGISTER_PERMS::READ_WRITE
+)
+
+DECLARE_REGISTER_32(
+  r_type_instruction,
+  opcode, 0, 6,
+  rd, 7, 11,
+  funct3, 12, 14,
+  rs1, 15, 19,
+  rs2, 20, 24,
+  funct7, 25, 31
+);
+
+DECLARE_REGISTER_32(
+  i_type_instruction,
+  opcode, 0, 6,
+  rd, 7, 11,
+  funct3, 12, 14,
+  rs1, 15, 19,
+  imm, 20, 31
+);
+
+using instruction_decoder = register_decoder<0, 6,
+    register_format<0x33, r_type_instruction>,
+    register_format<0x13, i_type_instruction>>;
+
+struct instruction_visitor {
+    uint64_t sum = 0;
+    void operator()(const r_type_instruction &instruction) { sum += instruction.get_rd(); }
+    void operator()(const i_type_instruction &instruction) { sum += instruction.get_imm(); }
+};
+
+static constexpr size_t REGISTER_COUNT = 1 << 20;
+
+int main(int argc, char *argv[]) {
+    const char *output = nullptr;
+    const char *baseline = nullptr;
+    double threshold = 0.05;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--output") == 0) {
+            output = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--baseline") == 0) {
+            baseline = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--threshold") == 0) {
+            threshold = std::atof(argv[i + 1]);
+        }
+    }
+
+    std::vector<link_capabilites_register> link_cap_regs(REGISTER_COUNT);
+    std::vector<link_capabilites_register_rev2> link_cap_regs_rev2(REGISTER_COUNT);
+    std::vector<link_control_register> link_ctrl_regs(REGISTER_COUNT);
+    std::vector<uint32_t> instructions(REGISTER_COUNT);
+    for (size_t i = 0; i < REGISTER_COUNT; i++) {
+        uint32_t value = static_cast<uint32_t>(i * 2654435761u);
+        link_cap_regs[i].set_register_value(value);
+        link_ctrl_regs[i].set_register_value(static_cast<uint16_t>(value >> 16));
+        instructions[i] = (value & ~0x7Fu) | (i % 3 == 0 ? 0x33 : 0x13);
+    }
+    std::vector<uint8_t> stream(REGISTER_COUNT * 4);
+    register_bit_writer writer(stream.data(), stream.size());
+    for (size_t i = 0; i < REGISTER_COUNT; i++) {
+        writer.write_bits(i & 0x1, 1);
+        writer.write(link_cap_regs[i]);
+    }
+    writer.flush();
+
+    bench_harness harness;
+    harness.print_header();
+
+    harness.run("get", REGISTER_COUNT, [&] {
+        uint64_t sum = 0;
+        for (const link_capabilites_register &link_cap_reg : link_cap_regs) {
+            sum += link_cap_reg.get_max_link_width();
+        }
+        return sum;
+    });
+
+    harness.run("set", REGISTER_COUNT, [&] {
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            link_cap_regs[i].set_l1_exit_latency(i & 0b111);
+        }
+        return static_cast<uint64_t>(link_cap_regs[REGISTER_COUNT - 1].get_register_value());
+    });
+
+    harness.run("get_with_perms", REGISTER_COUNT, [&] {
+        uint64_t sum = 0;
+        for (const link_control_register &link_ctrl_reg : link_ctrl_regs) {
+            sum += link_ctrl_reg.get_aspm_control();
+        }
+        return sum;
+    });
+
+    harness.run("set_with_perms", REGISTER_COUNT, [&] {
+        uint64_t failures = 0;
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            failures += !link_ctrl_regs[i].set_retrain_link(i & 0b1);
+        }
+        return failures;
+    });
+
+    harness.run("transcode", REGISTER_COUNT, [&] {
+        transcode<link_capabilites_register, link_capabilites_register_rev2>(
+            link_cap_regs.data(), link_cap_regs_rev2.data(), REGISTER_COUNT);
+        return static_cast<uint64_t>(link_cap_regs_rev2[REGISTER_COUNT - 1].get_register_value());
+    });
+
+    harness.run("decode", REGISTER_COUNT, [&] {
+        instruction_visitor visitor;
+        instruction_decoder::decode(instructions.data(), REGISTER_COUNT, visitor);
+        return visitor.sum;
+    });
+
+    harness.run("bit_reader", REGISTER_COUNT, [&] {
+        register_bit_reader reader(stream.data(), stream.size());
+        link_capabilites_register link_cap_reg;
+        uint64_t tag;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < REGISTER_COUNT && reader.read_bits(1, tag) && reader.read(link_cap_reg); i++) {
+            sum += link_cap_reg.get_port_number();
+        }
+        return sum;
+    });
+
+    harness.run("crc32c", REGISTER_COUNT, [&] {
+        return static_cast<uint64_t>(register_crc32c(link_cap_regs.data(), REGISTER_COUNT));
+    });
+
+    harness.run("fingerprinted_set", REGISTER_COUNT, [&] {
+        static register_fingerprinted_block<link_capabilites_register, 64> block;
+        for (size_t i = 0; i < REGISTER_COUNT; i++) {
+            block.set(i % 64, link_cap_regs[i]);
+        }
+        return static_cast<uint64_t>(block.fingerprint());
+    });
+
+    harness.run("format", REGISTER_COUNT / 64, [&] {
+        char text[160];
+        uint64_t length = 0;
+        for (size_t i = 0; i < REGISTER_COUNT / 64; i++) {
+            length += format_register(link_cap_regs[i], text, sizeof(text));
+        }
+        return length;
+    });
+
+    if (output != nullptr && !harness.write_json(output)) {
+        std::printf("could not write %s\n", output);
+        return 1;
+    }
+    if (baseline != nullptr && harness.compare_json(baseline, threshold) != 0) {
+        return 1;
+    }
+    return 0;
+}
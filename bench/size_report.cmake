@@ -0,0 +1,29 @@
+# Run through the size_report target:
+#   cmake -DSIZE=size -DOBJECT_0=... -DOBJECT_1=... -DOBJECT_17=... -P size_report.cmake
+
+function(text_size OBJECT RESULT)
+    execute_process(
+        COMMAND ${SIZE} -A ${OBJECT}
+        OUTPUT_VARIABLE output
+        COMMAND_ERROR_IS_FATAL ANY
+    )
+    # Sum every .text* section, cold helpers end up in .text.unlikely
+    set(total 0)
+    string(REGEX MATCHALL "\n\\.text[^ ]* +[0-9]+" sections "${output}")
+    foreach(section ${sections})
+        string(REGEX MATCH "[0-9]+$" bytes "${section}")
+        math(EXPR total "${total} + ${bytes}")
+    endforeach()
+    set(${RESULT} ${total} PARENT_SCOPE)
+endfunction()
+
+text_size(${OBJECT_0} text_0)
+text_size(${OBJECT_1} text_1)
+text_size(${OBJECT_17} text_17)
+
+math(EXPR per_register "(${text_17} - ${text_1}) / 16")
+math(EXPR shared "${text_1} - ${text_0} - ${per_register}")
+
+message("text bytes with 0/1/17 registers: ${text_0}/${text_1}/${text_17}")
+message("shared helpers: ${shared} bytes")
+message("per register: ${per_register} bytes")
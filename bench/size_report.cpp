@@ -0,0 +1,47 @@
+#include <jacobs_register_helper.h>
+
+// Compiled into objects with SIZE_REPORT_REGISTER_COUNT set to 0, 1 and 17.
+// size_report.cmake compares their .text sizes to split the cost into the
+// shared helpers and the code stamped out per register.
+
+#define SIZE_REPORT_REGISTER(N)\
+    DECLARE_REGISTER_32(\
+      size_report_register_##N,\
+      max_link_speed, 0, 3,\
+      max_link_width, 4, 9,\
+      aspm_support, 10, 11,\
+      l0s_exit_latency, 12, 14,\
+      l1_exit_latency, 15, 17,\
+      port_number, 24, 31\
+    );\
+    uint32_t use_size_report_register_##N(uint32_t raw, char *text, size_t size) {\
+        size_report_register_##N reg;\
+        reg.set_register_value(raw);\
+        reg.set_aspm_support(reg.get_max_link_speed() & 0b11);\
+        reg.set_port_number(reg.get_max_link_width());\
+        format_register(reg, text, size);\
+        return reg.get_register_value() ^ get_reserved_bits(reg);\
+    }
+
+#if SIZE_REPORT_REGISTER_COUNT >= 1
+SIZE_REPORT_REGISTER(0)
+#endif
+
+#if SIZE_REPORT_REGISTER_COUNT >= 17
+SIZE_REPORT_REGISTER(1)
+SIZE_REPORT_REGISTER(2)
+SIZE_REPORT_REGISTER(3)
+SIZE_REPORT_REGISTER(4)
+SIZE_REPORT_REGISTER(5)
+SIZE_REPORT_REGISTER(6)
+SIZE_REPORT_REGISTER(7)
+SIZE_REPORT_REGISTER(8)
+SIZE_REPORT_REGISTER(9)
+SIZE_REPORT_REGISTER(10)
+SIZE_REPORT_REGISTER(11)
+SIZE_REPORT_REGISTER(12)
+SIZE_REPORT_REGISTER(13)
+SIZE_REPORT_REGISTER(14)
+SIZE_REPORT_REGISTER(15)
+SIZE_REPORT_REGISTER(16)
+#endif
@@ -1,6 +1,21 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <jacobs_register_helper.h>
+#include <jacobs_register_archive.h>
+#include <jacobs_register_columnar.h>
+#include <jacobs_register_memory.h>
+#include <jacobs_register_pipeline.h>
+#include <jacobs_register_query.h>
+#include <jacobs_register_snapshot.h>
+#include <jacobs_register_transport.h>
 
 DECLARE_REGISTER_32(
   link_capabilites_register,
@@ -32,6 +47,75 @@ DECLARE_REGISTER_16_WITH_PERMS(
     link_autonomous_bandwidth_interrupt_enable, 11, 11, REGISTER_PERMS::READ_WRITE
 )
 
+// The same layout as link_capabilites_register, written as an MSB0 spec would
+DECLARE_REGISTER_32_WITH_NUMBERING(
+  link_capabilites_register_msb0,
+  MSB0,
+  max_link_speed, 28, 31,
+  max_link_width, 22, 27,
+  aspm_support, 20, 21,
+  port_number, 0, 7
+);
+
+// A later revision of the register where some of the fields have moved
+DECLARE_REGISTER_32(
+  link_capabilites_register_rev2,
+  port_number, 0, 7,
+  max_link_speed, 8, 11,
+  max_link_width, 12, 17,
+  aspm_support, 18, 19
+);
+
+// The first two words of an IPv4 header, numbered as in RFC 791
+DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(
+  ipv4_header_word_0,
+  MSB0,
+  version, 0, 3,
+  ihl, 4, 7,
+  dscp, 8, 13,
+  ecn, 14, 15,
+  total_length, 16, 31
+);
+
+DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(
+  ipv4_header_word_1,
+  MSB0,
+  identification, 0, 15,
+  flags, 16, 18,
+  fragment_offset, 19, 31
+);
+
+// Two RISC-V instruction formats that share the opcode field at bits 6:0
+DECLARE_REGISTER_32(
+  r_type_instruction,
+  opcode, 0, 6,
+  rd, 7, 11,
+  funct3, 12, 14,
+  rs1, 15, 19,
+  rs2, 20, 24,
+  funct7, 25, 31
+);
+
+DECLARE_REGISTER_32(
+  i_type_instruction,
+  opcode, 0, 6,
+  rd, 7, 11,
+  funct3, 12, 14,
+  rs1, 15, 19,
+  imm, 20, 31
+);
+
+using instruction_decoder = register_decoder<0, 6,
+    register_format<0x33, r_type_instruction>,
+    register_format<0x13, i_type_instruction>>;
+
+struct instruction_visitor {
+    uint32_t r_type_count = 0;
+    uint32_t last_imm = 0;
+    void operator()(const r_type_instruction &) { r_type_count++; }
+    void operator()(const i_type_instruction &instruction) { last_imm = instruction.get_imm(); }
+};
+
 int main (int argc, char *argv[]) {
     // Check setting whole register
     link_capabilites_register link_cap_reg;
@@ -62,5 +146,456 @@ int main (int argc, char *argv[]) {
     assert(link_ctrl_reg.get_register_value() == 0b10000);
     assert(link_ctrl_reg.get_link_disable() == 0b1);
 
+    // Check that MSB0 numbering lands on the same bits as LSB0 numbering
+    link_capabilites_register_msb0 link_cap_reg_msb0;
+    link_cap_reg_msb0.set_register_value(0xDEADBEEF);
+    assert(link_cap_reg_msb0.get_aspm_support() == 0b11);
+    assert(link_cap_reg_msb0.get_max_link_speed() == 0xF);
+    assert(link_cap_reg_msb0.get_port_number() == 0xDE);
+
+    // Check transcoding fields by name between two layouts
+    link_capabilites_register_rev2 link_cap_reg_rev2 =
+        transcode<link_capabilites_register_msb0, link_capabilites_register_rev2>(link_cap_reg_msb0);
+    assert(link_cap_reg_rev2.get_port_number() == 0xDE);
+    assert(link_cap_reg_rev2.get_max_link_speed() == 0xF);
+    assert(link_cap_reg_rev2.get_max_link_width() == link_cap_reg_msb0.get_max_link_width());
+    assert(link_cap_reg_rev2.get_aspm_support() == 0b11);
+
+    // Check big endian views directly over a packet buffer
+    uint8_t packet[] = {0x45, 0x00, 0x00, 0x54, 0x1C, 0x46, 0x40, 0x00};
+    ipv4_header_word_0 ipv4_word_0(packet);
+    ipv4_header_word_1 ipv4_word_1(packet + 4);
+    assert(ipv4_word_0.get_version() == 4);
+    assert(ipv4_word_0.get_ihl() == 5);
+    assert(ipv4_word_0.get_total_length() == 0x54);
+    assert(ipv4_word_1.get_identification() == 0x1C46);
+    assert(ipv4_word_1.get_flags() == 0b010);
+    assert(ipv4_word_1.set_fragment_offset(0x1234) == true);
+    assert(packet[6] == 0x52 && packet[7] == 0x34);
+
+    // Check dispatching instruction words on their opcode
+    // add x3, x1, x2 / addi x1, x0, 42 / an undeclared opcode
+    uint32_t instructions[] = {0x0020'81B3, 0x02A0'0093, 0x0000'007F};
+    instruction_visitor visitor;
+    assert(instruction_decoder::decode(instructions, 3, visitor) == 2);
+    assert(visitor.r_type_count == 1);
+    assert(visitor.last_imm == 42);
+
+    // Check packing registers of mixed widths back to back at bit offsets
+    uint8_t stream[16] = {};
+    register_bit_writer writer(stream, sizeof(stream));
+    link_cap_reg.set_register_value(0xDEADBEEF);
+    link_ctrl_reg.set_register_value(0xBEEF);
+    assert(writer.write_bits(0b101, 3));
+    assert(writer.write(link_cap_reg));
+    assert(writer.write(link_ctrl_reg));
+    assert(writer.flush() == 7);
+
+    register_bit_reader reader(stream, sizeof(stream));
+    uint64_t header = 0;
+    assert(reader.read_bits(3, header) && header == 0b101);
+    link_capabilites_register read_link_cap_reg;
+    link_control_register read_link_ctrl_reg;
+    assert(reader.read(read_link_cap_reg));
+    assert(reader.read(read_link_ctrl_reg));
+    assert(read_link_cap_reg.get_aspm_support() == 0b11);
+    assert(read_link_ctrl_reg.get_register_value() == 0xBEEF);
+    assert(reader.bit_position() == 51);
+
+    // Check the shared diagnostics helpers
+    char text[128];
+    link_capabilites_register_rev2 formatted_reg;
+    formatted_reg.set_register_value(0x0000'2F5A);
+    format_register(formatted_reg, text, sizeof(text));
+    assert(std::strcmp(text, "port_number=0x5a max_link_speed=0xf max_link_width=0x02 aspm_support=0x0") == 0);
+    uint64_t field_value = 0;
+    assert(get_register_field(formatted_reg, "max_link_speed", field_value) && field_value == 0xF);
+    assert(!get_register_field(formatted_reg, "no_such_field", field_value));
+    formatted_reg.set_register_value(0x8000'0000);
+    assert(get_reserved_bits(formatted_reg) == 0x8000'0000);
+
+    // Check that identical register blocks are only stored once
+    link_capabilites_register device_a[4];
+    link_capabilites_register device_b[4];
+    for (int i = 0; i < 4; i++) {
+        device_a[i].set_register_value(0xDEADBEEF + i);
+        device_b[i].set_register_value(0xDEADBEEF + i);
+    }
+    register_snapshot_store<link_capabilites_register> snapshots;
+    uint64_t device_a_key = snapshots.put(device_a, 4);
+    uint64_t device_b_key = snapshots.put(device_b, 4);
+    assert(device_a_key == device_b_key);
+    assert(snapshots.block_count() == 1);
+    device_b[3].set_aspm_support(0b00);
+    assert(snapshots.put(device_b, 4) != device_a_key);
+    assert(snapshots.block_count() == 2);
+    link_capabilites_register restored[4];
+    assert(snapshots.get(device_a_key, restored));
+    assert(restored[3].get_register_value() == 0xDEADBEEF + 3);
+
+    // Check a per report store and diff living in one arena
+    char report_buffer[4096];
+    std::pmr::monotonic_buffer_resource report_arena(report_buffer, sizeof(report_buffer));
+    register_snapshot_store<link_capabilites_register> report_snapshots(&report_arena);
+    uint64_t before_key = report_snapshots.put(device_a, 4);
+    uint64_t after_key = report_snapshots.put(device_b, 4);
+    std::pmr::vector<register_field_change<link_capabilites_register>> changes(&report_arena);
+    assert(report_snapshots.diff(before_key, after_key, changes));
+    assert(changes.size() == 1 && changes[0].index == 3);
+    assert(std::strcmp(changes[0].field->name, "aspm_support") == 0);
+    assert(changes[0].before == device_a[3].get_aspm_support() && changes[0].after == 0b00);
+
+    // Check CRC32C fingerprints against the RFC 3720 test vectors, and that a
+    // fingerprinted block keeps its CRC current through writes
+    link_capabilites_register zero_regs[8];
+    link_capabilites_register ones_regs[8];
+    for (link_capabilites_register &ones_reg : ones_regs) {
+        ones_reg.set_register_value(0xFFFF'FFFF);
+    }
+    assert(register_crc32c(zero_regs, 8) == 0x8A91'36AA);
+    assert(register_crc32c(ones_regs, 8) == 0x62A8'AB43);
+    assert(register_crc32c(ones_regs + 3, 5, register_crc32c(ones_regs, 3)) == 0x62A8'AB43);
+    register_fingerprinted_block<link_capabilites_register, 8> device_config;
+    assert(device_config.fingerprint() == 0x8A91'36AA);
+    uint32_t baseline_fingerprint = device_config.fingerprint();
+    device_config.set(5, device_a[2]);
+    device_config.set(0, ones_regs[0]);
+    assert(device_config.fingerprint() == register_crc32c(device_config.data(), 8));
+    assert(device_config.fingerprint() != baseline_fingerprint);
+    device_config.set(5, zero_regs[0]);
+    device_config.set(0, zero_regs[0]);
+    assert(device_config.fingerprint() == baseline_fingerprint);
+    register_fingerprinted_block<link_control_register, 3> control_config;
+    link_control_register retrain;
+    retrain.set_retrain_link(1);
+    control_config.set(1, retrain);
+    assert(control_config.fingerprint() == register_crc32c(control_config.data(), 3));
+
+    // Check NUMA lookups against a sysfs fixture and node placed snapshots
+    std::filesystem::create_directories("example_sysfs/bus/pci/devices/0000:3b:00.0");
+    std::filesystem::create_directories("example_sysfs/bus/pci/devices/0000:00:1f.0");
+    std::filesystem::create_directories("example_sysfs/devices/system/node/node0");
+    std::filesystem::create_directories("example_sysfs/devices/system/node/node1");
+    std::ofstream("example_sysfs/bus/pci/devices/0000:3b:00.0/numa_node") << "1\n";
+    std::ofstream("example_sysfs/bus/pci/devices/0000:00:1f.0/numa_node") << "-1\n";
+    // Node 0 gets a CPU this process may run on, containers and CI hosts
+    // don't always allow CPU 0
+    cpu_set_t allowed_cpus;
+    CPU_ZERO(&allowed_cpus);
+    int sched_result = sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus);
+    assert(sched_result == 0);
+    int node0_cpu = 0;
+    while (!CPU_ISSET(node0_cpu, &allowed_cpus)) {
+        node0_cpu++;
+    }
+    std::ofstream("example_sysfs/devices/system/node/node0/cpulist") << node0_cpu << "\n";
+    std::ofstream("example_sysfs/devices/system/node/node1/cpulist") << "2-4,8,10-11\n";
+    assert(register_device_numa_node("0000:3b:00.0", "example_sysfs") == 1);
+    assert(register_device_numa_node("0000:00:1f.0", "example_sysfs") == -1);
+    assert(register_device_numa_node("0000:ff:00.0", "example_sysfs") == -1);
+    assert((register_numa_node_cpus(1, "example_sysfs") == std::vector<int>{2, 3, 4, 8, 10, 11}));
+    assert(register_numa_node_cpus(2, "example_sysfs").empty());
+    std::thread poller([node0_cpu] {
+        assert(register_pin_thread_to_node(0, "example_sysfs"));
+        assert(sched_getcpu() == node0_cpu);
+    });
+    poller.join();
+    std::filesystem::remove_all("example_sysfs");
+    register_numa_resource node_memory(0);
+    std::pmr::monotonic_buffer_resource node_arena(&node_memory);
+    register_snapshot_store<link_capabilites_register> node_snapshots(&node_arena);
+    assert(node_snapshots.put(device_a, 4) == device_a_key);
+    register_huge_page_resource huge_pages;
+    {
+        std::pmr::vector<link_capabilites_register> large_array(1 << 16, &huge_pages);
+        assert(reinterpret_cast<uintptr_t>(large_array.data()) % (2 << 20) == 0);
+        large_array[(1 << 16) - 1].set_port_number(7);
+        assert(large_array[(1 << 16) - 1].get_port_number() == 7);
+    }
+    assert(huge_pages.explicit_allocations() + huge_pages.transparent_allocations() == 1);
+    // Zero byte requests are valid for any memory resource
+    void *empty_block = node_memory.allocate(0);
+    node_memory.deallocate(empty_block, 0);
+    empty_block = huge_pages.allocate(0);
+    huge_pages.deallocate(empty_block, 0);
+
+    // Check a streaming pipeline over 1000 snapshot records of 4 registers
+    // piped in from another thread, capping link speeds on the way through
+    int stream_pipe[2];
+    int pipe_result = pipe(stream_pipe);
+    assert(pipe_result == 0);
+    std::thread producer([&stream_pipe] {
+        for (uint32_t record = 0; record < 1000; record++) {
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t raw = record * 4 + i;
+                ssize_t written = write(stream_pipe[1], &raw, sizeof(raw));
+                assert(written == sizeof(raw));
+            }
+        }
+        uint8_t partial = 0xAA;
+        ssize_t written = write(stream_pipe[1], &partial, 1);
+        assert(written == 1);
+        close(stream_pipe[1]);
+    });
+    register_snapshot_pipeline<link_capabilites_register> pipeline(4, 64, 4);
+    size_t fast_links = 0;
+    uint64_t ingested_sum = 0;
+    register_pipeline_stats stats = pipeline.run(stream_pipe[0],
+        [&fast_links](link_capabilites_register *record, size_t registers) {
+            for (size_t i = 0; i < registers; i++) {
+                if (record[i].get_max_link_speed() > 3) {
+                    fast_links++;
+                    record[i].set_max_link_speed(3);
+                }
+            }
+        },
+        [&ingested_sum](const link_capabilites_register *record, size_t registers) {
+            for (size_t i = 0; i < registers; i++) {
+                assert(record[i].get_max_link_speed() <= 3);
+                ingested_sum += record[i].get_register_value();
+            }
+        });
+    producer.join();
+    close(stream_pipe[0]);
+    assert(stats.records == 1000 && stats.batches == 16);
+    assert(stats.bytes == 16001 && stats.truncated_bytes == 1 && !stats.read_error);
+    assert(fast_links == 3000);
+    uint64_t expected_sum = 0;
+    for (uint32_t raw = 0; raw < 4000; raw++) {
+        expected_sum += (raw & 0xF) > 3 ? (raw & ~0xFu) | 3 : raw;
+    }
+    assert(ingested_sum == expected_sum);
+
+    // Check zero sizes are rejected, and that a throwing sink stops the
+    // pipeline on a pipe that stays open and reaches the caller
+    bool rejected = false;
+    try {
+        register_snapshot_pipeline<link_capabilites_register> empty_records(0);
+    } catch (const std::invalid_argument &) {
+        rejected = true;
+    }
+    assert(rejected);
+    pipe_result = pipe(stream_pipe);
+    assert(pipe_result == 0);
+    uint32_t first_record[4] = {1, 2, 3, 4};
+    ssize_t record_written = write(stream_pipe[1], first_record, sizeof(first_record));
+    assert(record_written == sizeof(first_record));
+    bool sink_threw = false;
+    try {
+        register_snapshot_pipeline<link_capabilites_register>(4, 1, 2).run(stream_pipe[0],
+            [](link_capabilites_register *, size_t) {},
+            [](const link_capabilites_register *, size_t) { throw std::runtime_error("sink full"); });
+    } catch (const std::runtime_error &) {
+        sink_threw = true;
+    }
+    assert(sink_threw);
+    close(stream_pipe[0]);
+    close(stream_pipe[1]);
+
+    // Check batching bus accesses against mock devices with 50us transactions
+    register_mock_device retimer(256, 32, std::chrono::microseconds(50), std::chrono::nanoseconds(100));
+    register_mock_device sensor(256, 0, std::chrono::microseconds(50), std::chrono::nanoseconds(100), REGISTER_BYTE_ORDER::BIG);
+    for (size_t i = 0; i < 256; i++) {
+        retimer.data()[i] = sensor.data()[i] = static_cast<uint8_t>(i);
+    }
+    link_capabilites_register lanes[16];
+    for (register_mock_device *device : {&retimer, &sensor}) {
+        register_transaction_batch bus_batch(*device);
+        for (uint32_t i = 0; i < 16; i++) {
+            bus_batch.read(i * 4, lanes[i]);
+        }
+        assert(bus_batch.pending() == 16 && bus_batch.execute() && bus_batch.pending() == 0);
+    }
+    assert(retimer.transactions() == 2 && sensor.transactions() == 16);
+    assert(retimer.bus_time() < sensor.bus_time() / 4);
+    assert(lanes[15].get_register_value() == 0x3C3D3E3F);
+    link_control_register bus_ctrl;
+    bus_ctrl.set_register_value(0xBEEF);
+    assert(register_bus_write(sensor, 0x80, bus_ctrl));
+    assert(sensor.data()[0x80] == 0xBE && sensor.data()[0x81] == 0xEF);
+    register_transaction_batch mixed(retimer);
+    mixed.write(0x80, bus_ctrl);
+    mixed.write(0x82, bus_ctrl);
+    mixed.read(0x80, lanes[0]);
+    mixed.read(0x84, lanes[1]);
+    assert(mixed.execute() && retimer.transactions() == 4);
+    assert(lanes[0].get_register_value() == 0xBEEF'BEEF && lanes[1].get_register_value() == 0x8786'8584);
+    assert(!register_bus_read(retimer, 0xFE, lanes[0]));
+
+    // Check a snapshot of 32 consecutive dwords in memory takes 64 bit
+    // accesses, and that 16 bit registers and misaligned runs split correctly
+    alignas(8) uint32_t bar[40];
+    for (uint32_t i = 0; i < 40; i++) {
+        bar[i] = 0x1000'0000 + i;
+    }
+    register_mmio_bus mmio(bar, sizeof(bar));
+    link_capabilites_register bar_snapshot[32];
+    register_transaction_batch snapshot_batch(mmio);
+    for (uint32_t i = 0; i < 32; i++) {
+        snapshot_batch.read(i * 4, bar_snapshot[i]);
+    }
+    assert(snapshot_batch.execute() && mmio.transactions() == 16);
+    assert(bar_snapshot[0].get_register_value() == 0x1000'0000 && bar_snapshot[31].get_register_value() == 0x1000'001F);
+    register_mmio_bus mmio_32(bar, sizeof(bar), 4);
+    register_transaction_batch narrow_batch(mmio_32);
+    for (uint32_t i = 0; i < 32; i++) {
+        narrow_batch.read(i * 4, bar_snapshot[i]);
+    }
+    assert(narrow_batch.execute() && mmio_32.transactions() == 32);
+    register_mmio_bus mmio_wide(bar, sizeof(bar), 16);
+    register_transaction_batch wide_batch(mmio_wide);
+    for (uint32_t i = 0; i < 4; i++) {
+        wide_batch.read(i * 4, bar_snapshot[i]);
+    }
+    assert(mmio_wide.max_block_size() == 8 && wide_batch.execute() && mmio_wide.transactions() == 2);
+    assert(bar_snapshot[3].get_register_value() == 0x1000'0003);
+
+    // Check register addresses that don't fit an SPI command byte beside the
+    // read flag are refused rather than sent to another register. /dev/null
+    // stands in for the SPI device, nothing reaches it.
+    register_spi_bus spi;
+    assert(spi.open("/dev/null", 1'000'000, 64));
+    assert(spi.accepts_block(0x7C, 4) && !spi.accepts_block(0x7E, 4) && !spi.accepts_block(0x85, 1));
+    assert(!spi.accepts_block(0x100, 1));
+    register_transaction_batch spi_batch(spi);
+    spi_batch.write(0x85, bus_ctrl);
+    assert(!spi_batch.execute() && spi.transactions() == 1);
+    link_control_register bar_ctrls[4];
+    register_transaction_batch ctrl_batch(mmio);
+    for (uint32_t i = 0; i < 4; i++) {
+        bar_ctrls[i].set_register_value(static_cast<uint16_t>(0xA0 + i));
+        ctrl_batch.write(0x80 + i * 2, bar_ctrls[i]);
+    }
+    assert(ctrl_batch.execute() && mmio.transactions() == 17);
+    assert(bar[32] == 0x00A1'00A0 && bar[33] == 0x00A3'00A2);
+    for (uint32_t i = 1; i < 4; i++) {
+        ctrl_batch.read(i * 4, bar_snapshot[i]);
+    }
+    assert(ctrl_batch.execute() && mmio.transactions() == 19);
+    assert(bar_snapshot[1].get_register_value() == 0x1000'0001 && bar_snapshot[3].get_register_value() == 0x1000'0003);
+
+    // Check sorting and grouping captured registers by a field
+    link_capabilites_register ports[5];
+    const char *port_names[5] = {"a", "b", "c", "d", "e"};
+    uint32_t port_widths[5] = {16, 4, 16, 1, 4};
+    for (int i = 0; i < 5; i++) {
+        ports[i].set_max_link_width(port_widths[i]);
+    }
+    constexpr register_field_info max_link_width = register_field<link_capabilites_register>("max_link_width");
+    std::vector<uint32_t> by_width = sort_permutation_by_field(ports, 5, max_link_width);
+    const char *sorted_names[5];
+    apply_permutation(by_width, port_names, sorted_names);
+    assert(std::strcmp(sorted_names[0], "d") == 0);
+    assert(std::strcmp(sorted_names[1], "b") == 0 && std::strcmp(sorted_names[2], "e") == 0);
+    assert(std::strcmp(sorted_names[3], "a") == 0 && std::strcmp(sorted_names[4], "c") == 0);
+    register_field_index width_index = build_field_index(ports, 5, max_link_width);
+    assert(width_index.groups.size() == 3);
+    const register_field_index::group *x4_ports = width_index.find(4);
+    assert(x4_ports != nullptr && x4_ports->end - x4_ports->begin == 2);
+    assert(width_index.find(8) == nullptr);
+
+    // Check bitmap index queries: ports with L1 supported and speed < 3
+    for (int i = 0; i < 5; i++) {
+        ports[i].set_aspm_support(i % 4);
+        ports[i].set_max_link_speed(i + 1);
+    }
+    constexpr register_field_info aspm_support = register_field<link_capabilites_register>("aspm_support");
+    constexpr register_field_info max_link_speed = register_field<link_capabilites_register>("max_link_speed");
+    register_bitmap_index aspm_index(ports, 5, aspm_support);
+    register_bitmap_index speed_index(ports, 5, max_link_speed);
+    register_bitmap l1_slow_ports = aspm_index.in({0b10, 0b11}) & speed_index.range(0, 2);
+    assert(l1_slow_ports.to_rows() == std::vector<uint32_t>{});
+    register_bitmap l1_ports = aspm_index.in({0b10, 0b11}) & speed_index.range(0, 4);
+    assert((l1_ports.to_rows() == std::vector<uint32_t>{2, 3}));
+
+    // Check the same question through a query over a memory mapped archive
+    assert(write_register_archive("example_archive.bin", ports, 5));
+    register_mapped_archive<link_capabilites_register> archive;
+    assert(archive.open("example_archive.bin"));
+    assert(archive.size() == 5);
+    register_query<link_capabilites_register> fleet(archive.data(), archive.size(), 2);
+    register_predicate l1_supported = field_in(aspm_support, {0b10, 0b11});
+    assert(fleet.count_matches(l1_supported & field_less(max_link_speed, 3)) == 0);
+    assert((fleet.select(l1_supported & field_between(max_link_speed, 1, 4)) == std::vector<size_t>{2, 3}));
+    assert((fleet.project(l1_supported | field_equal(max_link_speed, 1), max_link_speed) == std::vector<uint32_t>{1, 3, 4}));
+    assert(fleet.count_matches(register_predicate()) == 5);
+    archive.close();
+    std::remove("example_archive.bin");
+
+    // Check zone maps skip the chunks without the rarely set exit latency
+    constexpr register_field_info l1_exit_latency = register_field<link_capabilites_register>("l1_exit_latency");
+    std::vector<uint32_t> captured(4096, 0x0);
+    link_capabilites_register rare;
+    rare.set_l1_exit_latency(0b111);
+    captured[3000] = rare.get_register_value();
+    register_zone_map<link_capabilites_register> zones(captured.data(), captured.size());
+    assert(zones.chunk_count() == 4);
+    assert(zones[2].any_set == rare.get_register_value() && zones[2].all_set == 0x0);
+    assert((zones.candidates(field_equal(l1_exit_latency, 0b111)) == std::vector<uint8_t>{0, 0, 1, 0}));
+    register_query<link_capabilites_register> zoned(captured.data(), captured.size(), 1, &zones);
+    assert((zoned.select(field_equal(l1_exit_latency, 0b111)) == std::vector<size_t>{3000}));
+    assert(zoned.count_matches(field_less(l1_exit_latency, 0b111)) == 4095);
+
+    // Check the dictionary encoding of the same capture, two distinct values
+    register_dictionary_archive<link_capabilites_register> encoded(captured.data(), captured.size());
+    assert(encoded.dictionary().size() == 2 && encoded.code_width() == 1);
+    assert(encoded.value(3000) == rare.get_register_value() && encoded.value(2999) == 0x0);
+    assert(encoded.count_matches(field_equal(l1_exit_latency, 0b111)) == 1);
+    assert((encoded.select(field_equal(l1_exit_latency, 0b111)) == std::vector<size_t>{3000}));
+    assert(encoded.project(field_less(l1_exit_latency, 0b111), l1_exit_latency).size() == 4095);
+    assert(encoded.size_in_bytes() < captured.size() * sizeof(uint32_t) / 16);
+
+    // Check a columnar snapshot of two register types across 4096 devices
+    std::vector<link_capabilites_register> fleet_caps(4096);
+    std::vector<link_control_register> fleet_ctrls(4096);
+    for (size_t i = 0; i < 4096; i++) {
+        fleet_caps[i].set_register_value(captured[i]);
+        fleet_ctrls[i].set_register_value(static_cast<uint16_t>(i));
+    }
+    register_column_writer columns;
+    columns.add_column("link_capabilities", fleet_caps.data(), fleet_caps.size());
+    columns.add_column("link_control", fleet_ctrls.data(), fleet_ctrls.size());
+    assert(columns.write("example_columns.bin"));
+    register_columnar_file snapshot;
+    assert(snapshot.open("example_columns.bin"));
+    assert(snapshot.columns().size() == 2);
+    assert(snapshot.find("link_capabilities")->encoding == REGISTER_COLUMN_ENCODING::DICTIONARY);
+    assert(snapshot.find("link_control")->encoding == REGISTER_COLUMN_ENCODING::PLAIN);
+    assert(snapshot.find("link_control")->fields[3].name == "retrain_link");
+    register_column<link_capabilites_register> caps_column;
+    assert(snapshot.read_column("link_capabilities", caps_column));
+    assert(std::equal(captured.begin(), captured.end(), caps_column.data()) && caps_column.size() == 4096);
+    register_column<link_control_register> ctrl_column;
+    assert(snapshot.read_column("link_control", ctrl_column) && ctrl_column.data()[1234] == 1234);
+    assert(!snapshot.read_column("link_control", caps_column));
+    snapshot.close();
+    // A corrupted dictionary entry count fails the read rather than
+    // allocating and leaves the column empty. An unknown encoding, or a footer
+    // too short to hold its own size, fails the open.
+    {
+        std::fstream patch("example_columns.bin", std::ios::in | std::ios::out | std::ios::binary);
+        patch.write("\xff\xff\xff\xff", 4);
+    }
+    assert(snapshot.open("example_columns.bin") && !snapshot.read_column("link_capabilities", caps_column));
+    assert(caps_column.size() == 0 && caps_column.data() == nullptr);
+    snapshot.close();
+    {
+        // The first column's encoding follows its 2 byte name length and name
+        std::fstream patch("example_columns.bin", std::ios::in | std::ios::out | std::ios::binary);
+        patch.seekg(-8, std::ios::end);
+        uint32_t footer_size = 0;
+        patch.read(reinterpret_cast<char *>(&footer_size), sizeof(footer_size));
+        patch.seekp(-4 - static_cast<std::streamoff>(footer_size) + 2 + std::strlen("link_capabilities"), std::ios::end);
+        patch.write("\x07", 1);
+    }
+    assert(!snapshot.open("example_columns.bin"));
+    {
+        std::fstream patch("example_columns.bin", std::ios::in | std::ios::out | std::ios::binary);
+        patch.seekp(-8, std::ios::end);
+        patch.write("\0\0\0\0", 4);
+    }
+    assert(!snapshot.open("example_columns.bin"));
+    std::remove("example_columns.bin");
+
     return 0;
 }
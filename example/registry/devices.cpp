@@ -0,0 +1,16 @@
+#include "registers.h"
+
+// Only declared in this translation unit
+DECLARE_REGISTER_32(
+  device_status_register,
+  link_up, 0, 0,
+  error_count, 8, 15
+);
+
+int device_register_count() {
+    link_control_register link_ctrl_reg;
+    link_ctrl_reg.set_retrain_link(1);
+    device_status_register status;
+    status.set_link_up(link_ctrl_reg.get_retrain_link());
+    return static_cast<int>(status.get_link_up()) + 2;
+}
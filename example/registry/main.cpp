@@ -0,0 +1,28 @@
+#include <cassert>
+#include <cstring>
+#include "registers.h"
+
+// Checks the registry across two translation units that both declare
+// link_capabilites_register and link_control_register, one of which also
+// declares device_status_register. Built with and without -Wl,--gc-sections.
+int main() {
+    register_registry registry;
+    assert(static_cast<int>(registry.size()) == device_register_count());
+
+    bool capabilities = false, control = false, status = false;
+    for (const register_descriptor &descriptor : registry) {
+        if (std::strcmp(descriptor.name, "link_capabilites_register") == 0) {
+            assert(!capabilities && descriptor.width == 32 && descriptor.field_count == 4);
+            capabilities = true;
+        } else if (std::strcmp(descriptor.name, "link_control_register") == 0) {
+            assert(!control && descriptor.width == 16 && std::strcmp(descriptor.fields[2].name, "retrain_link") == 0);
+            control = true;
+        } else if (std::strcmp(descriptor.name, "device_status_register") == 0) {
+            assert(!status && descriptor.field_count == 2);
+            status = true;
+        }
+    }
+    assert(capabilities && control && status);
+
+    return 0;
+}
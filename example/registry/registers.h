@@ -0,0 +1,22 @@
+#pragma once
+
+// Declared in both translation units, so each must still appear once
+#include <jacobs_register_helper.h>
+
+DECLARE_REGISTER_32(
+  link_capabilites_register,
+  max_link_speed, 0, 3,
+  max_link_width, 4, 9,
+  aspm_support, 10, 11,
+  port_number, 24, 31
+);
+
+DECLARE_REGISTER_16(
+  link_control_register,
+  aspm_control, 0, 1,
+  link_disable, 4, 4,
+  retrain_link, 5, 5
+);
+
+// Defined in devices.cpp, so the linker has a reason to keep that object
+int device_register_count();
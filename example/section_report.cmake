@@ -0,0 +1,46 @@
+# Run through the section_report target:
+#   cmake -DSIZE=size -DOBJECT=main.cpp.o -P section_report.cmake
+#
+# The object is built with -ffunction-sections -fdata-sections so every
+# function and table sits in its own section and can be classified by name.
+
+execute_process(
+    COMMAND ${SIZE} -A ${OBJECT}
+    OUTPUT_VARIABLE output
+    COMMAND_ERROR_IS_FATAL ANY
+)
+
+set(hot_text 0)
+set(cold_text 0)
+set(metadata 0)
+set(other 0)
+set(metadata_sections "")
+
+string(REPLACE "\n" ";" lines "${output}")
+foreach(line ${lines})
+    if(NOT line MATCHES "^(\\.[^ ]+|register_helper_registry) +([0-9]+)")
+        continue()
+    endif()
+    set(section ${CMAKE_MATCH_1})
+    set(bytes ${CMAKE_MATCH_2})
+    if(section MATCHES "^\\.(group|comment|note|eh_frame|rela)")
+        continue()
+    elseif(section MATCHES "^\\.text\\.unlikely")
+        math(EXPR cold_text "${cold_text} + ${bytes}")
+    elseif(section MATCHES "^\\.text")
+        math(EXPR hot_text "${hot_text} + ${bytes}")
+    elseif(section MATCHES "6fieldsE$|_register_descriptor|register_helper_registry")
+        math(EXPR metadata "${metadata} + ${bytes}")
+        list(APPEND metadata_sections "  ${section} ${bytes}")
+    else()
+        math(EXPR other "${other} + ${bytes}")
+    endif()
+endforeach()
+
+message("hot text (.text.*): ${hot_text} bytes")
+message("cold text (.text.unlikely.*): ${cold_text} bytes")
+message("register metadata (field tables, descriptors): ${metadata} bytes")
+foreach(section ${metadata_sections})
+    message("${section}")
+endforeach()
+message("other data: ${other} bytes")
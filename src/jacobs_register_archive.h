@@ -0,0 +1,410 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h for analysing large arrays of
+// captured registers, needs the standard library
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <vector>
+#include "jacobs_register_helper.h"
+
+namespace register_detail {
+    // Sorts keys and permutation together, looking at the low WIDTH bits of keys
+    inline void radix_sort(std::vector<uint32_t> &keys, std::vector<uint32_t> &permutation, uint8_t width) {
+        size_t count = keys.size();
+        std::vector<uint32_t> scratch_permutation(count);
+        std::vector<uint32_t> scratch_keys(count);
+        for (uint8_t shift = 0; shift < width; shift += 8) {
+            size_t offsets[256] = {};
+            for (size_t i = 0; i < count; i++) {
+                offsets[(keys[i] >> shift) & 0xFF]++;
+            }
+            if (count == 0 || offsets[(keys[0] >> shift) & 0xFF] == count) {
+                continue;
+            }
+            size_t total = 0;
+            for (size_t &offset : offsets) {
+                size_t bucket = offset;
+                offset = total;
+                total += bucket;
+            }
+            for (size_t i = 0; i < count; i++) {
+                size_t destination = offsets[(keys[i] >> shift) & 0xFF]++;
+                scratch_permutation[destination] = permutation[i];
+                scratch_keys[destination] = keys[i];
+            }
+            permutation.swap(scratch_permutation);
+            keys.swap(scratch_keys);
+        }
+    }
+
+    template <typename REGISTER>
+    void extract_sort_keys(const REGISTER *regs, size_t count, const register_field_info &field,
+        std::vector<uint32_t> &keys, std::vector<uint32_t> &permutation) {
+        keys.resize(count);
+        permutation.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            permutation[i] = static_cast<uint32_t>(i);
+            keys[i] = static_cast<uint32_t>(get_field_value(regs[i].get_register_value(), field));
+        }
+        radix_sort(keys, permutation, field.end - field.start + 1);
+    }
+}
+
+// Stable permutation that orders regs by the value of one field, computed with
+// an LSD radix sort over the field bits. The field is extracted once per
+// register and passes over byte digits that are identical for every register
+// are skipped, so low cardinality fields usually sort in a single pass.
+template <typename REGISTER>
+std::vector<uint32_t> sort_permutation_by_field(const REGISTER *regs, size_t count, const register_field_info &field) {
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> permutation;
+    register_detail::extract_sort_keys(regs, count, field, keys, permutation);
+    return permutation;
+}
+
+// Reorders any array to match a permutation from sort_permutation_by_field, so
+// metadata kept alongside the registers can follow the same order
+template <typename T>
+void apply_permutation(const std::vector<uint32_t> &permutation, const T *in, T *out) {
+    for (size_t i = 0; i < permutation.size(); i++) {
+        out[i] = in[permutation[i]];
+    }
+}
+
+// Secondary index grouping registers by the value of one field. Registers with
+// the same value are contiguous in permutation, groups are in ascending order.
+struct register_field_index {
+    struct group {
+        uint32_t value;
+        size_t begin;
+        size_t end;
+    };
+
+    std::vector<uint32_t> permutation;
+    std::vector<group> groups;
+
+    // Positions (into the original array) of every register with value,
+    // returned as a [begin, end) range into permutation
+    const group *find(uint32_t value) const {
+        size_t low = 0;
+        size_t high = groups.size();
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (groups[middle].value < value) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low < groups.size() && groups[low].value == value ? &groups[low] : nullptr;
+    }
+};
+
+template <typename REGISTER>
+register_field_index build_field_index(const REGISTER *regs, size_t count, const register_field_info &field) {
+    register_field_index index;
+    std::vector<uint32_t> keys;
+    register_detail::extract_sort_keys(regs, count, field, keys, index.permutation);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t value = keys[i];
+        if (index.groups.empty() || index.groups.back().value != value) {
+            index.groups.push_back(register_field_index::group{value, i, i});
+        }
+        index.groups.back().end = i + 1;
+    }
+    return index;
+}
+
+// Compressed set of row numbers in the style of a roaring bitmap. Rows are
+// split into chunks of 65536, each stored as a sorted array of 16 bit offsets
+// while sparse and as a 65536 bit bitset once it holds more than 4096 rows.
+class register_bitmap {
+    public:
+        void add(uint32_t row) {
+            uint16_t key = static_cast<uint16_t>(row >> 16);
+            uint16_t offset = static_cast<uint16_t>(row);
+            // Rows usually arrive in order, so check the last chunk first
+            container *chunk = nullptr;
+            if (!containers.empty() && containers.back().key == key) {
+                chunk = &containers.back();
+            } else {
+                auto position = std::lower_bound(containers.begin(), containers.end(), key,
+                    [](const container &lhs, uint16_t rhs) { return lhs.key < rhs; });
+                if (position == containers.end() || position->key != key) {
+                    position = containers.insert(position, container{key, {}, {}, 0});
+                }
+                chunk = &*position;
+            }
+            if (chunk->is_bitset()) {
+                uint64_t bit = uint64_t{1} << (offset % 64);
+                chunk->cardinality += (chunk->bits[offset / 64] & bit) == 0;
+                chunk->bits[offset / 64] |= bit;
+                return;
+            }
+            if (chunk->array.empty() || chunk->array.back() < offset) {
+                chunk->array.push_back(offset);
+            } else {
+                auto position = std::lower_bound(chunk->array.begin(), chunk->array.end(), offset);
+                if (*position == offset) {
+                    return;
+                }
+                chunk->array.insert(position, offset);
+            }
+            chunk->cardinality++;
+            normalize(*chunk);
+        }
+
+        bool contains(uint32_t row) const {
+            const container *chunk = find(static_cast<uint16_t>(row >> 16));
+            if (chunk == nullptr) {
+                return false;
+            }
+            uint16_t offset = static_cast<uint16_t>(row);
+            if (chunk->is_bitset()) {
+                return (chunk->bits[offset / 64] >> (offset % 64)) & 1;
+            }
+            return std::binary_search(chunk->array.begin(), chunk->array.end(), offset);
+        }
+
+        size_t cardinality() const {
+            size_t total = 0;
+            for (const container &chunk : containers) {
+                total += chunk.cardinality;
+            }
+            return total;
+        }
+
+        size_t size_in_bytes() const {
+            size_t total = 0;
+            for (const container &chunk : containers) {
+                total += sizeof(container) + chunk.array.size() * sizeof(uint16_t) + chunk.bits.size() * sizeof(uint64_t);
+            }
+            return total;
+        }
+
+        std::vector<uint32_t> to_rows() const {
+            std::vector<uint32_t> rows;
+            rows.reserve(cardinality());
+            for (const container &chunk : containers) {
+                uint32_t base = static_cast<uint32_t>(chunk.key) << 16;
+                if (chunk.is_bitset()) {
+                    for (size_t word = 0; word < chunk.bits.size(); word++) {
+                        for (uint64_t bits = chunk.bits[word]; bits != 0; bits &= bits - 1) {
+                            rows.push_back(base + static_cast<uint32_t>(word * 64 + count_trailing_zeros(bits)));
+                        }
+                    }
+                } else {
+                    for (uint16_t offset : chunk.array) {
+                        rows.push_back(base + offset);
+                    }
+                }
+            }
+            return rows;
+        }
+
+        register_bitmap operator&(const register_bitmap &other) const {
+            register_bitmap result;
+            size_t i = 0;
+            size_t j = 0;
+            while (i < containers.size() && j < other.containers.size()) {
+                if (containers[i].key < other.containers[j].key) {
+                    i++;
+                } else if (containers[i].key > other.containers[j].key) {
+                    j++;
+                } else {
+                    container chunk = intersect(containers[i], other.containers[j]);
+                    if (chunk.cardinality != 0) {
+                        result.containers.push_back(std::move(chunk));
+                    }
+                    i++;
+                    j++;
+                }
+            }
+            return result;
+        }
+
+        register_bitmap operator|(const register_bitmap &other) const {
+            register_bitmap result;
+            size_t i = 0;
+            size_t j = 0;
+            while (i < containers.size() || j < other.containers.size()) {
+                if (j == other.containers.size() || (i < containers.size() && containers[i].key < other.containers[j].key)) {
+                    result.containers.push_back(containers[i++]);
+                } else if (i == containers.size() || other.containers[j].key < containers[i].key) {
+                    result.containers.push_back(other.containers[j++]);
+                } else {
+                    result.containers.push_back(unite(containers[i++], other.containers[j++]));
+                }
+            }
+            return result;
+        }
+
+        register_bitmap &operator|=(const register_bitmap &other) {
+            *this = *this | other;
+            return *this;
+        }
+
+        register_bitmap &operator&=(const register_bitmap &other) {
+            *this = *this & other;
+            return *this;
+        }
+
+    private:
+        static constexpr size_t ARRAY_LIMIT = 4096;
+        static constexpr size_t BITSET_WORDS = 65536 / 64;
+
+        struct container {
+            uint16_t key;
+            std::vector<uint16_t> array;
+            std::vector<uint64_t> bits;
+            size_t cardinality;
+
+            bool is_bitset() const { return !bits.empty(); };
+        };
+
+        static int count_trailing_zeros(uint64_t bits) {
+            return static_cast<int>(std::bitset<64>((bits & -bits) - 1).count());
+        }
+
+        // Switches a chunk between array and bitset form to match its cardinality
+        static void normalize(container &chunk) {
+            if (!chunk.is_bitset() && chunk.cardinality > ARRAY_LIMIT) {
+                chunk.bits.assign(BITSET_WORDS, 0x0);
+                for (uint16_t offset : chunk.array) {
+                    chunk.bits[offset / 64] |= uint64_t{1} << (offset % 64);
+                }
+                chunk.array.clear();
+                chunk.array.shrink_to_fit();
+            } else if (chunk.is_bitset() && chunk.cardinality <= ARRAY_LIMIT) {
+                chunk.array.reserve(chunk.cardinality);
+                for (size_t word = 0; word < BITSET_WORDS; word++) {
+                    for (uint64_t bits = chunk.bits[word]; bits != 0; bits &= bits - 1) {
+                        chunk.array.push_back(static_cast<uint16_t>(word * 64 + count_trailing_zeros(bits)));
+                    }
+                }
+                chunk.bits.clear();
+                chunk.bits.shrink_to_fit();
+            }
+        }
+
+        static bool bitset_contains(const container &chunk, uint16_t offset) {
+            return (chunk.bits[offset / 64] >> (offset % 64)) & 1;
+        }
+
+        static container intersect(const container &lhs, const container &rhs) {
+            container result{lhs.key, {}, {}, 0};
+            if (lhs.is_bitset() && rhs.is_bitset()) {
+                result.bits.resize(BITSET_WORDS);
+                for (size_t word = 0; word < BITSET_WORDS; word++) {
+                    result.bits[word] = lhs.bits[word] & rhs.bits[word];
+                    result.cardinality += std::bitset<64>(result.bits[word]).count();
+                }
+            } else if (lhs.is_bitset() || rhs.is_bitset()) {
+                const container &array = lhs.is_bitset() ? rhs : lhs;
+                const container &bitset = lhs.is_bitset() ? lhs : rhs;
+                for (uint16_t offset : array.array) {
+                    if (bitset_contains(bitset, offset)) {
+                        result.array.push_back(offset);
+                    }
+                }
+                result.cardinality = result.array.size();
+            } else {
+                std::set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(),
+                    std::back_inserter(result.array));
+                result.cardinality = result.array.size();
+            }
+            normalize(result);
+            return result;
+        }
+
+        static container unite(const container &lhs, const container &rhs) {
+            container result{lhs.key, {}, {}, 0};
+            if (!lhs.is_bitset() && !rhs.is_bitset()) {
+                std::set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(),
+                    std::back_inserter(result.array));
+                result.cardinality = result.array.size();
+            } else {
+                result.bits.assign(BITSET_WORDS, 0x0);
+                for (const container *source : {&lhs, &rhs}) {
+                    if (source->is_bitset()) {
+                        for (size_t word = 0; word < BITSET_WORDS; word++) {
+                            result.bits[word] |= source->bits[word];
+                        }
+                    } else {
+                        for (uint16_t offset : source->array) {
+                            result.bits[offset / 64] |= uint64_t{1} << (offset % 64);
+                        }
+                    }
+                }
+                for (uint64_t word : result.bits) {
+                    result.cardinality += std::bitset<64>(word).count();
+                }
+            }
+            normalize(result);
+            return result;
+        }
+
+        const container *find(uint16_t key) const {
+            auto position = std::lower_bound(containers.begin(), containers.end(), key,
+                [](const container &lhs, uint16_t rhs) { return lhs.key < rhs; });
+            return position == containers.end() || position->key != key ? nullptr : &*position;
+        }
+
+        std::vector<container> containers;
+};
+
+// One register_bitmap of row numbers per distinct value of a field, meant for
+// low cardinality fields such as aspm_support or max_link_speed. Queries
+// combine the per value bitmaps instead of scanning the registers.
+class register_bitmap_index {
+    public:
+        template <typename REGISTER>
+        register_bitmap_index(const REGISTER *regs, size_t count, const register_field_info &field) {
+            for (size_t i = 0; i < count; i++) {
+                uint32_t value = static_cast<uint32_t>(get_field_value(regs[i].get_register_value(), field));
+                bitmaps[value].add(static_cast<uint32_t>(i));
+            }
+        }
+
+        // Rows where the field equals value
+        const register_bitmap &equal(uint32_t value) const {
+            static const register_bitmap empty;
+            auto bitmap = bitmaps.find(value);
+            return bitmap == bitmaps.end() ? empty : bitmap->second;
+        }
+
+        // Rows where low <= field <= high
+        register_bitmap range(uint32_t low, uint32_t high) const {
+            register_bitmap result;
+            for (auto bitmap = bitmaps.lower_bound(low); bitmap != bitmaps.end() && bitmap->first <= high; ++bitmap) {
+                result |= bitmap->second;
+            }
+            return result;
+        }
+
+        // Rows where the field is any of values
+        register_bitmap in(std::initializer_list<uint32_t> values) const {
+            register_bitmap result;
+            for (uint32_t value : values) {
+                result |= equal(value);
+            }
+            return result;
+        }
+
+        size_t distinct_values() const { return bitmaps.size(); };
+
+        size_t size_in_bytes() const {
+            size_t total = 0;
+            for (const auto &bitmap : bitmaps) {
+                total += bitmap.second.size_in_bytes();
+            }
+            return total;
+        }
+
+    private:
+        std::map<uint32_t, register_bitmap> bitmaps;
+};
@@ -0,0 +1,402 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h, a columnar file format for
+// snapshots of many register types across many devices. Needs the standard
+// library and POSIX mmap.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "jacobs_register_query.h"
+
+// Hash of a register's width and field names and bit ranges. Files record it
+// per column so a column is never read back with a different layout.
+template <typename REGISTER>
+constexpr uint64_t register_layout_hash() {
+    uint64_t hash = register_detail::hash_round(register_detail::HASH_PRIME_1, REGISTER::register_width);
+    for (size_t field = 0; field < REGISTER::field_count; field++) {
+        const register_field_info &info = REGISTER::fields[field];
+        for (const char *c = info.name; *c != '\0'; c++) {
+            hash = register_detail::hash_round(hash, static_cast<uint8_t>(*c));
+        }
+        hash = register_detail::hash_round(hash, (uint64_t{info.start} << 16) | (uint64_t{info.end} << 8) |
+            static_cast<uint64_t>(info.perms));
+    }
+    return register_detail::hash_avalanche(hash);
+}
+
+enum class REGISTER_COLUMN_ENCODING : uint8_t {
+    PLAIN,
+    DICTIONARY
+};
+
+// A field as recorded in a file footer
+struct register_column_field {
+    std::string name;
+    uint8_t start;
+    uint8_t end;
+    REGISTER_PERMS perms;
+};
+
+// A column as recorded in a file footer
+struct register_column_info {
+    std::string name;
+    REGISTER_COLUMN_ENCODING encoding;
+    uint8_t register_width;
+    uint64_t layout_hash;
+    uint64_t rows;
+    uint64_t offset;
+    uint64_t size;
+    std::vector<register_column_field> fields;
+};
+
+namespace register_detail {
+    // "JRCF" followed by the footer size ends every file
+    constexpr uint32_t COLUMNAR_MAGIC = 0x4643'524A;
+
+    inline void put_bytes(std::vector<uint8_t> &out, uint64_t value, size_t size) {
+        for (size_t byte = 0; byte < size; byte++) {
+            out.push_back(static_cast<uint8_t>(value >> (byte * 8)));
+        }
+    }
+
+    inline void put_string(std::vector<uint8_t> &out, const char *text, size_t length_size) {
+        size_t length = std::strlen(text);
+        put_bytes(out, length, length_size);
+        out.insert(out.end(), text, text + length);
+    }
+
+    inline void pad_to_8(std::vector<uint8_t> &out) {
+        out.resize((out.size() + 7) / 8 * 8, 0x0);
+    }
+
+    // Bounds checked little endian reads from a mapped footer
+    struct byte_reader {
+        const uint8_t *position;
+        const uint8_t *end;
+        bool valid = true;
+
+        uint64_t get(size_t size) {
+            if (static_cast<size_t>(end - position) < size) {
+                valid = false;
+                return 0;
+            }
+            uint64_t value = 0;
+            for (size_t byte = 0; byte < size; byte++) {
+                value |= static_cast<uint64_t>(position[byte]) << (byte * 8);
+            }
+            position += size;
+            return value;
+        }
+
+        std::string get_string(size_t length_size) {
+            size_t length = get(length_size);
+            if (static_cast<size_t>(end - position) < length) {
+                valid = false;
+                return std::string();
+            }
+            std::string text(reinterpret_cast<const char *>(position), length);
+            position += length;
+            return text;
+        }
+    };
+}
+
+// Collects one column chunk per register type and writes them, followed by a
+// footer describing each column, in a single file. Each column is stored plain
+// or dictionary encoded, whichever is smaller.
+class register_column_writer {
+    public:
+        template <typename REGISTER>
+        void add_column(const char *name, const REGISTER *regs, size_t count) {
+            using raw_type = typename REGISTER::raw_type;
+            std::vector<raw_type> values(count);
+            for (size_t i = 0; i < count; i++) {
+                values[i] = regs[i].get_register_value();
+            }
+
+            column chunk;
+            chunk.info.name = name;
+            chunk.info.register_width = REGISTER::register_width;
+            chunk.info.layout_hash = register_layout_hash<REGISTER>();
+            chunk.info.rows = count;
+            for (size_t field = 0; field < REGISTER::field_count; field++) {
+                const register_field_info &info = REGISTER::fields[field];
+                chunk.info.fields.push_back(register_column_field{info.name, info.start, info.end, info.perms});
+            }
+
+            register_dictionary_archive<REGISTER> encoded(values.data(), count);
+            size_t entries = encoded.dictionary().size();
+            size_t codes_per_word = 64 / encoded.code_width();
+            size_t dictionary_size = 8 + (entries * sizeof(raw_type) + 7) / 8 * 8 +
+                (count + codes_per_word - 1) / codes_per_word * 8;
+            if (dictionary_size < count * sizeof(raw_type)) {
+                chunk.info.encoding = REGISTER_COLUMN_ENCODING::DICTIONARY;
+                register_detail::put_bytes(chunk.bytes, entries, 4);
+                register_detail::put_bytes(chunk.bytes, encoded.code_width(), 4);
+                for (raw_type entry : encoded.dictionary()) {
+                    register_detail::put_bytes(chunk.bytes, entry, sizeof(raw_type));
+                }
+                register_detail::pad_to_8(chunk.bytes);
+                for (size_t first = 0; first < count; first += codes_per_word) {
+                    uint64_t word = 0;
+                    for (size_t i = first; i < count && i < first + codes_per_word; i++) {
+                        word |= static_cast<uint64_t>(encoded.code(i)) << ((i - first) * encoded.code_width());
+                    }
+                    register_detail::put_bytes(chunk.bytes, word, 8);
+                }
+            } else {
+                chunk.info.encoding = REGISTER_COLUMN_ENCODING::PLAIN;
+                for (raw_type value : values) {
+                    register_detail::put_bytes(chunk.bytes, value, sizeof(raw_type));
+                }
+            }
+            chunk.info.size = chunk.bytes.size();
+            columns.push_back(std::move(chunk));
+        }
+
+        // Returns false on any I/O error
+        bool write(const char *path) const {
+            FILE *file = std::fopen(path, "wb");
+            if (file == nullptr) {
+                return false;
+            }
+            bool written = true;
+            std::vector<uint8_t> footer;
+            uint64_t offset = 0;
+            for (const column &chunk : columns) {
+                std::vector<uint8_t> padded = chunk.bytes;
+                register_detail::pad_to_8(padded);
+                written = written && (padded.empty() || std::fwrite(padded.data(), padded.size(), 1, file) == 1);
+                append_info(footer, chunk.info, offset);
+                offset += padded.size();
+            }
+            register_detail::put_bytes(footer, columns.size(), 4);
+            register_detail::put_bytes(footer, footer.size() + 4, 4);
+            register_detail::put_bytes(footer, register_detail::COLUMNAR_MAGIC, 4);
+            written = written && std::fwrite(footer.data(), footer.size(), 1, file) == 1;
+            return std::fclose(file) == 0 && written;
+        }
+
+    private:
+        struct column {
+            register_column_info info;
+            std::vector<uint8_t> bytes;
+        };
+
+        static void append_info(std::vector<uint8_t> &footer, const register_column_info &info, uint64_t offset) {
+            register_detail::put_string(footer, info.name.c_str(), 2);
+            register_detail::put_bytes(footer, static_cast<uint8_t>(info.encoding), 1);
+            register_detail::put_bytes(footer, info.register_width, 1);
+            register_detail::put_bytes(footer, info.layout_hash, 8);
+            register_detail::put_bytes(footer, info.rows, 8);
+            register_detail::put_bytes(footer, offset, 8);
+            register_detail::put_bytes(footer, info.size, 8);
+            register_detail::put_bytes(footer, info.fields.size(), 2);
+            for (const register_column_field &field : info.fields) {
+                register_detail::put_string(footer, field.name.c_str(), 1);
+                register_detail::put_bytes(footer, field.start, 1);
+                register_detail::put_bytes(footer, field.end, 1);
+                register_detail::put_bytes(footer, static_cast<uint8_t>(field.perms), 1);
+            }
+        }
+
+        std::vector<column> columns;
+};
+
+// Raw values of one column. Plain columns point straight into the mapped
+// file, dictionary encoded ones are decoded into memory from the column's
+// memory resource.
+template <typename REGISTER>
+class register_column {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        explicit register_column(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+            decoded(resource) {}
+
+        const raw_type *data() const { return values; };
+        size_t size() const { return rows; };
+
+    private:
+        friend class register_columnar_file;
+
+        const raw_type *values = nullptr;
+        size_t rows = 0;
+        std::pmr::vector<raw_type> decoded;
+};
+
+// Maps a file written by register_column_writer and reads its footer. Only
+// the pages of the columns that are read are ever loaded from disk. Expects a
+// little endian host, like register_mapped_archive.
+class register_columnar_file {
+    public:
+        register_columnar_file() = default;
+        register_columnar_file(const register_columnar_file &) = delete;
+        register_columnar_file &operator=(const register_columnar_file &) = delete;
+
+        ~register_columnar_file() {
+            close();
+        }
+
+        // Returns false if the file can't be mapped or its footer is malformed
+        bool open(const char *path) {
+            close();
+            int descriptor = ::open(path, O_RDONLY);
+            if (descriptor < 0) {
+                return false;
+            }
+            struct stat status;
+            bool valid = fstat(descriptor, &status) == 0 && status.st_size >= 12;
+            if (valid) {
+                void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) {
+                    valid = false;
+                } else {
+                    mapped = static_cast<const uint8_t *>(mapping);
+                    mapped_size = status.st_size;
+                }
+            }
+            ::close(descriptor);
+            if (valid && !read_footer()) {
+                close();
+                valid = false;
+            }
+            return valid;
+        }
+
+        void close() {
+            if (mapped != nullptr) {
+                munmap(const_cast<uint8_t *>(mapped), mapped_size);
+            }
+            mapped = nullptr;
+            mapped_size = 0;
+            infos.clear();
+        }
+
+        const std::vector<register_column_info> &columns() const { return infos; };
+
+        const register_column_info *find(const char *name) const {
+            for (const register_column_info &info : infos) {
+                if (info.name == name) {
+                    return &info;
+                }
+            }
+            return nullptr;
+        }
+
+        // Returns false if there is no such column, it was written with a
+        // different layout of REGISTER or its chunk is malformed. column is
+        // left empty then.
+        template <typename REGISTER>
+        bool read_column(const char *name, register_column<REGISTER> &column) const {
+            using raw_type = typename REGISTER::raw_type;
+            column.values = nullptr;
+            column.rows = 0;
+            column.decoded.clear();
+            const register_column_info *info = find(name);
+            if (info == nullptr || info->layout_hash != register_layout_hash<REGISTER>() ||
+                info->register_width != REGISTER::register_width) {
+                return false;
+            }
+            const uint8_t *chunk = mapped + info->offset;
+            if (info->encoding == REGISTER_COLUMN_ENCODING::PLAIN) {
+                if (info->size % sizeof(raw_type) != 0 || info->rows != info->size / sizeof(raw_type)) {
+                    return false;
+                }
+                column.values = reinterpret_cast<const raw_type *>(chunk);
+                column.rows = info->rows;
+                return true;
+            }
+            register_detail::byte_reader reader{chunk, chunk + info->size};
+            size_t entries = reader.get(4);
+            uint8_t width = static_cast<uint8_t>(reader.get(4));
+            if (width == 0 || width > 32) {
+                return false;
+            }
+            // Both counts come from the file, check them against the chunk
+            // before allocating anything
+            size_t codes_per_word = 64 / width;
+            uint64_t dictionary_bytes = (entries * sizeof(raw_type) + 7) / 8 * 8;
+            uint64_t code_words = info->rows / codes_per_word + (info->rows % codes_per_word != 0);
+            uint64_t remaining = static_cast<uint64_t>(reader.end - reader.position);
+            if (dictionary_bytes > remaining || code_words > (remaining - dictionary_bytes) / 8) {
+                return false;
+            }
+            std::vector<raw_type> dictionary(entries);
+            for (raw_type &entry : dictionary) {
+                entry = static_cast<raw_type>(reader.get(sizeof(raw_type)));
+            }
+            reader.get((8 - entries * sizeof(raw_type) % 8) % 8);
+            uint64_t mask = (uint64_t{1} << width) - 1;
+            std::pmr::vector<raw_type> decoded(info->rows, column.decoded.get_allocator());
+            uint64_t word = 0;
+            for (size_t i = 0; i < info->rows && reader.valid; i++) {
+                if (i % codes_per_word == 0) {
+                    word = reader.get(8);
+                }
+                uint64_t code = word >> (i % codes_per_word * width) & mask;
+                if (code >= entries) {
+                    return false;
+                }
+                decoded[i] = dictionary[code];
+            }
+            if (!reader.valid) {
+                return false;
+            }
+            column.decoded = std::move(decoded);
+            column.values = column.decoded.data();
+            column.rows = info->rows;
+            return true;
+        }
+
+    private:
+        bool read_footer() {
+            register_detail::byte_reader tail{mapped + mapped_size - 8, mapped + mapped_size};
+            size_t footer_size = tail.get(4);
+            // The footer holds at least the column count and its own size
+            if (tail.get(4) != register_detail::COLUMNAR_MAGIC || footer_size < 8 || footer_size > mapped_size - 4) {
+                return false;
+            }
+            const uint8_t *footer = mapped + mapped_size - 4 - footer_size;
+            register_detail::byte_reader reader{footer, mapped + mapped_size - 12};
+            register_detail::byte_reader count_reader{mapped + mapped_size - 12, mapped + mapped_size - 8};
+            size_t column_count = count_reader.get(4);
+            for (size_t column = 0; column < column_count && reader.valid; column++) {
+                register_column_info info;
+                info.name = reader.get_string(2);
+                uint64_t encoding = reader.get(1);
+                if (encoding > static_cast<uint64_t>(REGISTER_COLUMN_ENCODING::DICTIONARY)) {
+                    return false;
+                }
+                info.encoding = static_cast<REGISTER_COLUMN_ENCODING>(encoding);
+                info.register_width = static_cast<uint8_t>(reader.get(1));
+                info.layout_hash = reader.get(8);
+                info.rows = reader.get(8);
+                info.offset = reader.get(8);
+                info.size = reader.get(8);
+                size_t field_count = reader.get(2);
+                for (size_t field = 0; field < field_count && reader.valid; field++) {
+                    register_column_field entry;
+                    entry.name = reader.get_string(1);
+                    entry.start = static_cast<uint8_t>(reader.get(1));
+                    entry.end = static_cast<uint8_t>(reader.get(1));
+                    entry.perms = static_cast<REGISTER_PERMS>(reader.get(1));
+                    info.fields.push_back(entry);
+                }
+                if (info.offset > static_cast<size_t>(footer - mapped) ||
+                    info.size > static_cast<size_t>(footer - mapped) - info.offset) {
+                    return false;
+                }
+                infos.push_back(info);
+            }
+            return reader.valid;
+        }
+
+        const uint8_t *mapped = nullptr;
+        size_t mapped_size = 0;
+        std::vector<register_column_info> infos;
+};
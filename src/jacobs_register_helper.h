@@ -1,6 +1,53 @@
 #pragma once
 
+// This header is freestanding. It only includes the headers below, never throws,
+// never allocates and does not use RTTI, so it can be used in boot firmware
+// built with -ffreestanding -fno-exceptions -fno-rtti. Anything that needs the
+// hosted library belongs in a separate header. The CRC instructions are used
+// through compiler builtins on x86, since the intrinsics headers include
+// <stdlib.h>, and through <arm_acle.h> (which only needs <stdint.h>) on ARM.
+#include <cstddef>
 #include <cstdint>
+#include <utility>
+#if !defined(__SSE4_2__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Accessors are forced inline so -O0 and -Og builds do not pay a call per field
+// access. Define REGISTER_HELPER_INLINE (for example as plain inline) before
+// including this header to opt out.
+#ifndef REGISTER_HELPER_INLINE
+#if defined(__GNUC__) || defined(__clang__)
+#define REGISTER_HELPER_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define REGISTER_HELPER_INLINE __forceinline
+#else
+#define REGISTER_HELPER_INLINE inline
+#endif
+#endif
+
+// Applied to the loops over register arrays so everything they call is inlined
+// into them, even in debug builds
+#ifndef REGISTER_HELPER_FLATTEN
+#if defined(__GNUC__) || defined(__clang__)
+#define REGISTER_HELPER_FLATTEN __attribute__((flatten))
+#else
+#define REGISTER_HELPER_FLATTEN
+#endif
+#endif
+
+// Diagnostics helpers (formatting, lookups by name) are rarely called, so they
+// are kept out of line and shared by every register type instead of being
+// stamped out per declaration
+#ifndef REGISTER_HELPER_COLD
+#if defined(__GNUC__) || defined(__clang__)
+#define REGISTER_HELPER_COLD inline __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define REGISTER_HELPER_COLD inline __declspec(noinline)
+#else
+#define REGISTER_HELPER_COLD inline
+#endif
+#endif
 
 enum class REGISTER_PERMS {
     NONE = 0b00,
@@ -9,10 +56,19 @@ enum class REGISTER_PERMS {
     READ_WRITE = 0b11
 };
 
+// Compile time description of a single field, every declared register exposes
+// a constexpr table of these as NAME::fields. START and END are always LSB0.
+struct register_field_info {
+    const char *name;
+    uint8_t start;
+    uint8_t end;
+    REGISTER_PERMS perms;
+};
+
 #define IMPLEMENT_REGISTER_16_GET(FIELD, START, END)\
     static_assert(START >= 0 && START < 16);\
     static_assert(END >= 0 && END < 16 && END >= START);\
-    inline uint16_t get_##FIELD() const {\
+    REGISTER_HELPER_INLINE uint16_t get_##FIELD() const {\
         uint16_t buffer = register_raw >> START;\
         return buffer & (0xFFFF >> (15 - (END - START)));\
     }
@@ -20,7 +76,7 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_16_SET(FIELD, START, END)\
     static_assert(START >= 0 && START < 16);\
     static_assert(END >= 0 && END < 16 && END >= START);\
-    inline bool set_##FIELD(uint16_t value) {\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint16_t value) {\
         if (value >= (1 << (END - START + 1))) {\
             return false;\
         }\
@@ -34,7 +90,7 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_32_GET(FIELD, START, END)\
     static_assert(START >= 0 && START < 32);\
     static_assert(END >= 0 && END < 32 && END >= START);\
-    inline uint16_t get_##FIELD() const {\
+    REGISTER_HELPER_INLINE uint16_t get_##FIELD() const {\
         uint16_t buffer = register_raw >> START;\
         return buffer & (0xFFFF'FFFF >> (31 - (END - START)));\
     }
@@ -42,7 +98,7 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_32_SET(FIELD, START, END)\
     static_assert(START >= 0 && START < 32);\
     static_assert(END >= 0 && END < 32 && END >= START);\
-    inline bool set_##FIELD(uint32_t value) {\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint32_t value) {\
         if (value >= (1 << (END - START + 1))) {\
             return false;\
         }\
@@ -56,8 +112,8 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_16_GET_WITH_PERMS(FIELD, START, END, PERMS)\
     static_assert(START >= 0 && START < 16);\
     static_assert(END >= 0 && END < 16 && END >= START);\
-    inline uint16_t get_##FIELD() const {\
-        static const bool allowed = static_cast<uint8_t>(PERMS) & 0b01;\
+    REGISTER_HELPER_INLINE uint16_t get_##FIELD() const {\
+        constexpr bool allowed = static_cast<uint8_t>(PERMS) & 0b01;\
         if (!allowed) {\
             return false;\
         }\
@@ -68,8 +124,8 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_16_SET_WITH_PERMS(FIELD, START, END, PERMS)\
     static_assert(START >= 0 && START < 16);\
     static_assert(END >= 0 && END < 16 && END >= START);\
-    inline bool set_##FIELD(uint16_t value) {\
-        static const bool allowed = static_cast<uint8_t>(PERMS) & 0b10;\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint16_t value) {\
+        constexpr bool allowed = static_cast<uint8_t>(PERMS) & 0b10;\
         if (!allowed) {\
             return false;\
         }\
@@ -86,8 +142,8 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_32_GET_WITH_PERMS(FIELD, START, END, PERMS)\
     static_assert(START >= 0 && START < 32);\
     static_assert(END >= 0 && END < 32 && END >= START);\
-    inline uint16_t get_##FIELD() const {\
-        static const bool allowed = static_cast<uint8_t>(PERMS) & 0b01;\
+    REGISTER_HELPER_INLINE uint16_t get_##FIELD() const {\
+        constexpr bool allowed = static_cast<uint8_t>(PERMS) & 0b01;\
         if (!allowed) {\
             return false;\
         }\
@@ -98,8 +154,8 @@ enum class REGISTER_PERMS {
 #define IMPLEMENT_REGISTER_32_SET_WITH_PERMS(FIELD, START, END, PERMS)\
     static_assert(START >= 0 && START < 32);\
     static_assert(END >= 0 && END < 32 && END >= START);\
-    inline bool set_##FIELD(uint32_t value) {\
-        static const bool allowed = static_cast<uint8_t>(PERMS) & 0b10;\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint32_t value) {\
+        constexpr bool allowed = static_cast<uint8_t>(PERMS) & 0b10;\
         if (!allowed) {\
             return false;\
         }\
@@ -113,6 +169,48 @@ enum class REGISTER_PERMS {
         return true;\
     }
 
+// Accessors for views over big endian byte arrays, these go through the
+// view's get_register_value()/set_register_value() instead of register_raw
+#define IMPLEMENT_REGISTER_16_VIEW_GET(FIELD, START, END)\
+    static_assert(START >= 0 && START < 16);\
+    static_assert(END >= 0 && END < 16 && END >= START);\
+    REGISTER_HELPER_INLINE uint16_t get_##FIELD() const {\
+        uint16_t buffer = get_register_value() >> START;\
+        return buffer & (0xFFFF >> (15 - (END - START)));\
+    }
+
+#define IMPLEMENT_REGISTER_16_VIEW_SET(FIELD, START, END)\
+    static_assert(START >= 0 && START < 16);\
+    static_assert(END >= 0 && END < 16 && END >= START);\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint16_t value) {\
+        if (value > (0xFFFF >> (15 - (END - START)))) {\
+            return false;\
+        }\
+        uint16_t mask = static_cast<uint16_t>(~((0xFFFF >> (15 - (END - START))) << START));\
+        set_register_value(static_cast<uint16_t>((get_register_value() & mask) | (value << START)));\
+        return true;\
+    }
+
+#define IMPLEMENT_REGISTER_32_VIEW_GET(FIELD, START, END)\
+    static_assert(START >= 0 && START < 32);\
+    static_assert(END >= 0 && END < 32 && END >= START);\
+    REGISTER_HELPER_INLINE uint32_t get_##FIELD() const {\
+        uint32_t buffer = get_register_value() >> START;\
+        return buffer & (0xFFFF'FFFF >> (31 - (END - START)));\
+    }
+
+#define IMPLEMENT_REGISTER_32_VIEW_SET(FIELD, START, END)\
+    static_assert(START >= 0 && START < 32);\
+    static_assert(END >= 0 && END < 32 && END >= START);\
+    REGISTER_HELPER_INLINE bool set_##FIELD(uint32_t value) {\
+        if (value > (0xFFFF'FFFF >> (31 - (END - START)))) {\
+            return false;\
+        }\
+        uint32_t mask = static_cast<uint32_t>(~((0xFFFF'FFFF >> (31 - (END - START))) << START));\
+        set_register_value((get_register_value() & mask) | (value << START));\
+        return true;\
+    }
+
 // Absolutely magical FOR_EACH MACRO inspired by https://www.scs.stanford.edu/~dm/blog/va-opt.html
 #define PARENS ()
 
@@ -137,55 +235,894 @@ enum class REGISTER_PERMS {
     __VA_OPT__(FOR_EACH_FIELD_WITH_PERMS_AGAIN PARENS (macro, __VA_ARGS__))
 #define FOR_EACH_FIELD_WITH_PERMS_AGAIN() FOR_EACH_FIELD_WITH_PERMS_HELPER
 
-// Declare macros
-#define DECLARE_REGISTER_16(NAME, ...)\
+// Compile time description of a whole register, see REGISTER_HELPER_ENABLE_REGISTRY
+struct register_descriptor {
+    const char *name;
+    uint8_t width;
+    const register_field_info *fields;
+    size_t field_count;
+};
+
+// With REGISTER_HELPER_ENABLE_REGISTRY defined, every declaration also places a
+// pointer to a constexpr register_descriptor in the register_helper_registry
+// linker section. Each pointer sits in its own COMDAT group so the linker keeps
+// one per register however many translation units include the declaration,
+// and tools can enumerate every register type in a binary with no static
+// constructors. GCC merges all variables with the same section attribute into
+// one group, hence the assembler directives. Requires an ELF toolchain, and
+// register names must be unique across namespaces. The entry is a variable
+// and an asm declaration at namespace scope, so with the registry enabled
+// registers can't be declared inside a class.
+#ifdef REGISTER_HELPER_ENABLE_REGISTRY
+#if !defined(__ELF__) || !(defined(__GNUC__) || defined(__clang__))
+#error "REGISTER_HELPER_ENABLE_REGISTRY needs a GNU compatible ELF toolchain"
+#endif
+#define REGISTER_HELPER_REGISTRY_ENTRY(NAME)\
+    __attribute__((used)) inline constexpr register_descriptor NAME##_register_descriptor\
+        asm("register_helper_descriptor_" #NAME) = {\
+        #NAME, NAME::register_width, NAME::fields, NAME::field_count};\
+    asm(".pushsection register_helper_registry,\"awG\",@progbits,register_helper_registry_" #NAME ",comdat\n"\
+        ".balign 8\n"\
+        ".dc.a register_helper_descriptor_" #NAME "\n"\
+        ".popsection");
+
+extern "C" {
+    // Provided by the linker, weak so that a binary with no registers links
+    extern const register_descriptor *const __start_register_helper_registry[] __attribute__((weak));
+    extern const register_descriptor *const __stop_register_helper_registry[] __attribute__((weak));
+}
+
+// Every register declared anywhere in the binary, in no particular order
+struct register_registry {
+    struct iterator {
+        const register_descriptor *const *entry;
+        const register_descriptor &operator*() const { return **entry; };
+        const register_descriptor *operator->() const { return *entry; };
+        iterator &operator++() { entry++; return *this; };
+        bool operator!=(const iterator &other) const { return entry != other.entry; };
+        bool operator==(const iterator &other) const { return entry == other.entry; };
+    };
+    iterator begin() const { return iterator{__start_register_helper_registry}; };
+    iterator end() const { return iterator{__stop_register_helper_registry}; };
+    size_t size() const { return static_cast<size_t>(__stop_register_helper_registry - __start_register_helper_registry); };
+};
+#else
+#define REGISTER_HELPER_REGISTRY_ENTRY(NAME)
+#endif
+
+#define IMPLEMENT_REGISTER_FIELD_INFO(FIELD, START, END)\
+    register_field_info{#FIELD, START, END, REGISTER_PERMS::READ_WRITE},
+
+#define IMPLEMENT_REGISTER_FIELD_INFO_WITH_PERMS(FIELD, START, END, PERMS)\
+    register_field_info{#FIELD, START, END, PERMS},
+
+// Bit numbering conventions. LSB0 counts bit 0 as the least significant bit,
+// MSB0 counts bit 0 as the most significant bit (PowerPC/IBM style specs).
+// MSB0 fields are converted to LSB0 positions at compile time, so both produce
+// identical accessors.
+#define IMPLEMENT_REGISTER_16_GET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_GET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_16_SET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_SET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_16_GET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_GET(FIELD, (15 - (END)), (15 - (START)))
+#define IMPLEMENT_REGISTER_16_SET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_SET(FIELD, (15 - (END)), (15 - (START)))
+
+#define IMPLEMENT_REGISTER_32_GET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_GET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_32_SET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_SET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_32_GET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_GET(FIELD, (31 - (END)), (31 - (START)))
+#define IMPLEMENT_REGISTER_32_SET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_SET(FIELD, (31 - (END)), (31 - (START)))
+
+#define IMPLEMENT_REGISTER_16_VIEW_GET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_VIEW_GET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_16_VIEW_SET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_VIEW_SET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_16_VIEW_GET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_VIEW_GET(FIELD, (15 - (END)), (15 - (START)))
+#define IMPLEMENT_REGISTER_16_VIEW_SET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_16_VIEW_SET(FIELD, (15 - (END)), (15 - (START)))
+
+#define IMPLEMENT_REGISTER_32_VIEW_GET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_VIEW_GET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_32_VIEW_SET_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_VIEW_SET(FIELD, START, END)
+#define IMPLEMENT_REGISTER_32_VIEW_GET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_VIEW_GET(FIELD, (31 - (END)), (31 - (START)))
+#define IMPLEMENT_REGISTER_32_VIEW_SET_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_32_VIEW_SET(FIELD, (31 - (END)), (31 - (START)))
+
+#define IMPLEMENT_REGISTER_16_FIELD_INFO_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_FIELD_INFO(FIELD, START, END)
+#define IMPLEMENT_REGISTER_16_FIELD_INFO_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_FIELD_INFO(FIELD, (15 - (END)), (15 - (START)))
+#define IMPLEMENT_REGISTER_32_FIELD_INFO_LSB0(FIELD, START, END) IMPLEMENT_REGISTER_FIELD_INFO(FIELD, START, END)
+#define IMPLEMENT_REGISTER_32_FIELD_INFO_MSB0(FIELD, START, END) IMPLEMENT_REGISTER_FIELD_INFO(FIELD, (31 - (END)), (31 - (START)))
+
+#define IMPLEMENT_REGISTER_16_GET_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_16_GET_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_16_SET_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_16_SET_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_16_GET_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_16_GET_WITH_PERMS(FIELD, (15 - (END)), (15 - (START)), PERMS)
+#define IMPLEMENT_REGISTER_16_SET_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_16_SET_WITH_PERMS(FIELD, (15 - (END)), (15 - (START)), PERMS)
+
+#define IMPLEMENT_REGISTER_32_GET_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_32_GET_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_32_SET_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_32_SET_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_32_GET_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_32_GET_WITH_PERMS(FIELD, (31 - (END)), (31 - (START)), PERMS)
+#define IMPLEMENT_REGISTER_32_SET_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_32_SET_WITH_PERMS(FIELD, (31 - (END)), (31 - (START)), PERMS)
+
+#define IMPLEMENT_REGISTER_16_FIELD_INFO_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_FIELD_INFO_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_16_FIELD_INFO_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_FIELD_INFO_WITH_PERMS(FIELD, (15 - (END)), (15 - (START)), PERMS)
+#define IMPLEMENT_REGISTER_32_FIELD_INFO_WITH_PERMS_LSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_FIELD_INFO_WITH_PERMS(FIELD, START, END, PERMS)
+#define IMPLEMENT_REGISTER_32_FIELD_INFO_WITH_PERMS_MSB0(FIELD, START, END, PERMS) IMPLEMENT_REGISTER_FIELD_INFO_WITH_PERMS(FIELD, (31 - (END)), (31 - (START)), PERMS)
+
+// Declare macros, NUMBERING is either LSB0 or MSB0
+#define DECLARE_REGISTER_16_WITH_NUMBERING(NAME, NUMBERING, ...)\
     class NAME {\
         public:\
-            NAME() {}\
-            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_GET, __VA_ARGS__);\
-            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_SET, __VA_ARGS__);\
-            uint16_t get_register_value() { return register_raw; };\
-            void clear_register_value() { register_raw = 0x0; };\
-            void set_register_value(uint16_t value) { register_raw = value; };\
+            using raw_type = uint16_t;\
+            static constexpr uint8_t register_width = 16;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_FIELD_INFO_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE NAME() {}\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_GET_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_SET_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint16_t get_register_value() const { return register_raw; };\
+            REGISTER_HELPER_INLINE void clear_register_value() { register_raw = 0x0; };\
+            REGISTER_HELPER_INLINE void set_register_value(uint16_t value) { register_raw = value; };\
         private:\
             uint16_t register_raw = 0x0;\
-    };
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
 
-#define DECLARE_REGISTER_32(NAME, ...)\
+#define DECLARE_REGISTER_32_WITH_NUMBERING(NAME, NUMBERING, ...)\
     class NAME {\
         public:\
-            NAME() {}\
-            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_GET, __VA_ARGS__);\
-            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_SET, __VA_ARGS__);\
-            uint32_t get_register_value() { return register_raw; };\
-            void clear_register_value() { register_raw = 0x0; };\
-            void set_register_value(uint32_t value) { register_raw = value; };\
+            using raw_type = uint32_t;\
+            static constexpr uint8_t register_width = 32;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_FIELD_INFO_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE NAME() {}\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_GET_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_SET_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint32_t get_register_value() const { return register_raw; };\
+            REGISTER_HELPER_INLINE void clear_register_value() { register_raw = 0x0; };\
+            REGISTER_HELPER_INLINE void set_register_value(uint32_t value) { register_raw = value; };\
         private:\
             uint32_t register_raw = 0x0;\
-    };
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
 
-#define DECLARE_REGISTER_16_WITH_PERMS(NAME, ...)\
+#define DECLARE_REGISTER_16_WITH_PERMS_AND_NUMBERING(NAME, NUMBERING, ...)\
     class NAME {\
         public:\
-            NAME() {}\
-            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_16_GET_WITH_PERMS, __VA_ARGS__);\
-            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_16_SET_WITH_PERMS, __VA_ARGS__);\
-            uint16_t get_register_value() { return register_raw; };\
-            void clear_register_value() { register_raw = 0x0; };\
-            void set_register_value(uint16_t value) { register_raw = value; };\
+            using raw_type = uint16_t;\
+            static constexpr uint8_t register_width = 16;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_16_FIELD_INFO_WITH_PERMS_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE NAME() {}\
+            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_16_GET_WITH_PERMS_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_16_SET_WITH_PERMS_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint16_t get_register_value() const { return register_raw; };\
+            REGISTER_HELPER_INLINE void clear_register_value() { register_raw = 0x0; };\
+            REGISTER_HELPER_INLINE void set_register_value(uint16_t value) { register_raw = value; };\
         private:\
             uint16_t register_raw = 0x0;\
-    };
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
 
-#define DECLARE_REGISTER_32_WITH_PERMS(NAME, ...)\
+#define DECLARE_REGISTER_32_WITH_PERMS_AND_NUMBERING(NAME, NUMBERING, ...)\
     class NAME {\
         public:\
-            NAME() {}\
-            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_32_GET_WITH_PERMS, __VA_ARGS__);\
-            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_32_SET_WITH_PERMS, __VA_ARGS__);\
-            uint32_t get_register_value() { return register_raw; };\
-            void clear_register_value() { register_raw = 0x0; };\
-            void set_register_value(uint32_t value) { register_raw = value; };\
+            using raw_type = uint32_t;\
+            static constexpr uint8_t register_width = 32;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_32_FIELD_INFO_WITH_PERMS_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE NAME() {}\
+            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_32_GET_WITH_PERMS_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD_WITH_PERMS(IMPLEMENT_REGISTER_32_SET_WITH_PERMS_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint32_t get_register_value() const { return register_raw; };\
+            REGISTER_HELPER_INLINE void clear_register_value() { register_raw = 0x0; };\
+            REGISTER_HELPER_INLINE void set_register_value(uint32_t value) { register_raw = value; };\
         private:\
             uint32_t register_raw = 0x0;\
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
+
+// Zero copy views over big endian byte arrays such as packet headers. The view
+// does not own the bytes, every access loads or stores through the pointer.
+#define DECLARE_REGISTER_16_BIG_ENDIAN_VIEW_WITH_NUMBERING(NAME, NUMBERING, ...)\
+    class NAME {\
+        public:\
+            using raw_type = uint16_t;\
+            static constexpr uint8_t register_width = 16;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_FIELD_INFO_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE explicit NAME(uint8_t *bytes) : register_bytes(bytes) {}\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_VIEW_GET_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_16_VIEW_SET_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint16_t get_register_value() const {\
+                return static_cast<uint16_t>((register_bytes[0] << 8) | register_bytes[1]);\
+            };\
+            REGISTER_HELPER_INLINE void clear_register_value() { set_register_value(0x0); };\
+            REGISTER_HELPER_INLINE void set_register_value(uint16_t value) {\
+                register_bytes[0] = static_cast<uint8_t>(value >> 8);\
+                register_bytes[1] = static_cast<uint8_t>(value);\
+            };\
+            REGISTER_HELPER_INLINE uint8_t *data() const { return register_bytes; };\
+        private:\
+            uint8_t *register_bytes;\
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
+
+#define DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(NAME, NUMBERING, ...)\
+    class NAME {\
+        public:\
+            using raw_type = uint32_t;\
+            static constexpr uint8_t register_width = 32;\
+            static constexpr register_field_info fields[] = {\
+                FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_FIELD_INFO_##NUMBERING, __VA_ARGS__)\
+            };\
+            static constexpr size_t field_count = sizeof(fields) / sizeof(fields[0]);\
+            REGISTER_HELPER_INLINE explicit NAME(uint8_t *bytes) : register_bytes(bytes) {}\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_VIEW_GET_##NUMBERING, __VA_ARGS__);\
+            FOR_EACH_FIELD(IMPLEMENT_REGISTER_32_VIEW_SET_##NUMBERING, __VA_ARGS__);\
+            REGISTER_HELPER_INLINE uint32_t get_register_value() const {\
+                return (static_cast<uint32_t>(register_bytes[0]) << 24) |\
+                    (static_cast<uint32_t>(register_bytes[1]) << 16) |\
+                    (static_cast<uint32_t>(register_bytes[2]) << 8) |\
+                    static_cast<uint32_t>(register_bytes[3]);\
+            };\
+            REGISTER_HELPER_INLINE void clear_register_value() { set_register_value(0x0); };\
+            REGISTER_HELPER_INLINE void set_register_value(uint32_t value) {\
+                register_bytes[0] = static_cast<uint8_t>(value >> 24);\
+                register_bytes[1] = static_cast<uint8_t>(value >> 16);\
+                register_bytes[2] = static_cast<uint8_t>(value >> 8);\
+                register_bytes[3] = static_cast<uint8_t>(value);\
+            };\
+            REGISTER_HELPER_INLINE uint8_t *data() const { return register_bytes; };\
+        private:\
+            uint8_t *register_bytes;\
+    };\
+    REGISTER_HELPER_REGISTRY_ENTRY(NAME)
+
+#define DECLARE_REGISTER_16(NAME, ...)\
+    DECLARE_REGISTER_16_WITH_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+#define DECLARE_REGISTER_32(NAME, ...)\
+    DECLARE_REGISTER_32_WITH_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+#define DECLARE_REGISTER_16_WITH_PERMS(NAME, ...)\
+    DECLARE_REGISTER_16_WITH_PERMS_AND_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+#define DECLARE_REGISTER_32_WITH_PERMS(NAME, ...)\
+    DECLARE_REGISTER_32_WITH_PERMS_AND_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+#define DECLARE_REGISTER_16_BIG_ENDIAN_VIEW(NAME, ...)\
+    DECLARE_REGISTER_16_BIG_ENDIAN_VIEW_WITH_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+#define DECLARE_REGISTER_32_BIG_ENDIAN_VIEW(NAME, ...)\
+    DECLARE_REGISTER_32_BIG_ENDIAN_VIEW_WITH_NUMBERING(NAME, LSB0, __VA_ARGS__)
+
+namespace register_detail {
+    constexpr bool field_names_equal(const char *lhs, const char *rhs) {
+        while (*lhs != '\0' && *lhs == *rhs) {
+            lhs++;
+            rhs++;
+        }
+        return *lhs == *rhs;
+    }
+
+    // Returns REGISTER::field_count when no field of that name exists
+    template <typename REGISTER>
+    constexpr size_t find_field(const char *name) {
+        for (size_t i = 0; i < REGISTER::field_count; i++) {
+            if (field_names_equal(REGISTER::fields[i].name, name)) {
+                return i;
+            }
+        }
+        return REGISTER::field_count;
+    }
+
+    constexpr uint64_t field_mask(const register_field_info &field) {
+        return (0xFFFF'FFFF'FFFF'FFFF >> (63 - (field.end - field.start))) << field.start;
+    }
+
+    // A single shift applied to every source bit in mask, fields that move by
+    // the same distance share a step
+    struct transcode_step {
+        int shift;
+        uint64_t mask;
     };
+
+    template <size_t MAX_STEPS>
+    struct transcode_plan {
+        transcode_step steps[MAX_STEPS + 1];
+        size_t count;
+        bool widths_match;
+    };
+
+    template <typename FROM, typename TO>
+    constexpr transcode_plan<TO::field_count> make_transcode_plan() {
+        transcode_plan<TO::field_count> plan{};
+        plan.widths_match = true;
+        for (size_t i = 0; i < TO::field_count; i++) {
+            size_t from_index = find_field<FROM>(TO::fields[i].name);
+            if (from_index == FROM::field_count) {
+                continue;
+            }
+            const register_field_info &from_field = FROM::fields[from_index];
+            const register_field_info &to_field = TO::fields[i];
+            if (from_field.end - from_field.start != to_field.end - to_field.start) {
+                plan.widths_match = false;
+            }
+            int shift = static_cast<int>(to_field.start) - static_cast<int>(from_field.start);
+            size_t step = 0;
+            while (step < plan.count && plan.steps[step].shift != shift) {
+                step++;
+            }
+            if (step == plan.count) {
+                plan.steps[plan.count++] = transcode_step{shift, 0x0};
+            }
+            plan.steps[step].mask |= field_mask(from_field);
+        }
+        return plan;
+    }
+
+    template <typename FROM, typename TO>
+    constexpr transcode_plan<TO::field_count> transcode_plan_v = make_transcode_plan<FROM, TO>();
+
+    REGISTER_HELPER_INLINE constexpr uint64_t apply_transcode_step(uint64_t value, const transcode_step &step) {
+        value &= step.mask;
+        return step.shift >= 0 ? value << step.shift : value >> -step.shift;
+    }
+
+    template <typename FROM, typename TO, size_t... STEPS>
+    REGISTER_HELPER_INLINE constexpr typename TO::raw_type transcode_raw(typename FROM::raw_type value, std::index_sequence<STEPS...>) {
+        return static_cast<typename TO::raw_type>(
+            (apply_transcode_step(value, transcode_plan_v<FROM, TO>.steps[STEPS]) | ... | uint64_t{0x0}));
+    }
+}
+
+// Converts a register between two layouts by matching fields by name at
+// compile time. Fields missing from FROM are left clear in the result, fields
+// missing from TO are dropped.
+template <typename FROM, typename TO>
+REGISTER_HELPER_INLINE TO transcode(const FROM &source) {
+    static_assert(register_detail::transcode_plan_v<FROM, TO>.widths_match,
+        "transcoded fields must have the same width in both registers");
+    TO destination;
+    destination.set_register_value(register_detail::transcode_raw<FROM, TO>(
+        source.get_register_value(), std::make_index_sequence<register_detail::transcode_plan_v<FROM, TO>.count>{}));
+    return destination;
+}
+
+template <typename FROM, typename TO>
+REGISTER_HELPER_FLATTEN inline void transcode(const FROM *source, TO *destination, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        destination[i] = transcode<FROM, TO>(source[i]);
+    }
+}
+
+// Associates an opcode value with the register declaration used to decode it
+template <uint32_t OPCODE, typename FORMAT>
+struct register_format {
+    static constexpr uint32_t opcode = OPCODE;
+    using type = FORMAT;
+};
+
+// Decodes 32 bit words that share an opcode field at bits START to END (LSB0)
+// into one of several register declarations. The opcode indexes a jump table
+// built at compile time, so decoding a word is one load and one indirect call.
+template <uint8_t START, uint8_t END, typename... FORMATS>
+class register_decoder {
+    static_assert(END >= START && END < 32);
+    static_assert(END - START < 12, "opcode fields wider than 12 bits make the jump table too large");
+    static_assert(((FORMATS::type::register_width == 32) && ...), "formats must be 32 bit registers");
+
+    public:
+        static constexpr size_t table_size = size_t{1} << (END - START + 1);
+
+        // Calls visitor(format) with the decoded register, returns false if no
+        // format was declared for the word's opcode
+        template <typename VISITOR>
+        REGISTER_HELPER_INLINE static bool decode(uint32_t word, VISITOR &visitor) {
+            return table<VISITOR>.entries[(word >> START) & (table_size - 1)](word, visitor);
+        }
+
+        // Returns the number of words that decoded to a declared format
+        template <typename VISITOR>
+        REGISTER_HELPER_FLATTEN static size_t decode(const uint32_t *words, size_t count, VISITOR &visitor) {
+            size_t decoded = 0;
+            for (size_t i = 0; i < count; i++) {
+                decoded += decode(words[i], visitor);
+            }
+            return decoded;
+        }
+
+    private:
+        template <typename VISITOR>
+        struct dispatch_table {
+            bool (*entries[table_size])(uint32_t, VISITOR &);
+        };
+
+        template <typename FORMAT, typename VISITOR>
+        static bool dispatch(uint32_t word, VISITOR &visitor) {
+            FORMAT format;
+            format.set_register_value(word);
+            visitor(static_cast<const FORMAT &>(format));
+            return true;
+        }
+
+        template <typename VISITOR>
+        static bool unknown(uint32_t, VISITOR &) {
+            return false;
+        }
+
+        static constexpr bool opcodes_are_unique() {
+            uint32_t opcodes[] = {FORMATS::opcode..., 0};
+            for (size_t i = 0; i < sizeof...(FORMATS); i++) {
+                for (size_t j = i + 1; j < sizeof...(FORMATS); j++) {
+                    if (opcodes[i] == opcodes[j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        template <typename VISITOR>
+        static constexpr dispatch_table<VISITOR> make_table() {
+            static_assert(((FORMATS::opcode < table_size) && ...), "opcode does not fit in the opcode field");
+            static_assert(opcodes_are_unique(), "each opcode can only be declared once");
+            dispatch_table<VISITOR> dispatch_table{};
+            for (size_t i = 0; i < table_size; i++) {
+                dispatch_table.entries[i] = &unknown<VISITOR>;
+            }
+            ((dispatch_table.entries[FORMATS::opcode] = &dispatch<typename FORMATS::type, VISITOR>), ...);
+            return dispatch_table;
+        }
+
+        template <typename VISITOR>
+        static constexpr dispatch_table<VISITOR> table = make_table<VISITOR>();
+};
+
+namespace register_detail {
+    // Compilers turn these into single unaligned loads/stores on little endian targets
+    REGISTER_HELPER_INLINE uint64_t load_le64(const uint8_t *bytes) {
+        return static_cast<uint64_t>(bytes[0]) |
+            (static_cast<uint64_t>(bytes[1]) << 8) |
+            (static_cast<uint64_t>(bytes[2]) << 16) |
+            (static_cast<uint64_t>(bytes[3]) << 24) |
+            (static_cast<uint64_t>(bytes[4]) << 32) |
+            (static_cast<uint64_t>(bytes[5]) << 40) |
+            (static_cast<uint64_t>(bytes[6]) << 48) |
+            (static_cast<uint64_t>(bytes[7]) << 56);
+    }
+
+    REGISTER_HELPER_INLINE void store_le32(uint8_t *bytes, uint32_t value) {
+        bytes[0] = static_cast<uint8_t>(value);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+        bytes[2] = static_cast<uint8_t>(value >> 16);
+        bytes[3] = static_cast<uint8_t>(value >> 24);
+    }
+}
+
+// Reads registers packed back to back at arbitrary bit offsets, least
+// significant bit first. Bits are pulled from the buffer 64 at a time.
+class register_bit_reader {
+    public:
+        register_bit_reader(const uint8_t *bytes, size_t byte_count) : data(bytes), size(byte_count) {}
+
+        // Pulls REGISTER::register_width bits into reg, returns false without
+        // consuming anything if the stream does not have that many bits left
+        template <typename REGISTER>
+        REGISTER_HELPER_INLINE bool read(REGISTER &reg) {
+            uint64_t value;
+            if (!read_bits(REGISTER::register_width, value)) {
+                return false;
+            }
+            reg.set_register_value(static_cast<typename REGISTER::raw_type>(value));
+            return true;
+        }
+
+        // COUNT can be at most 56 bits
+        REGISTER_HELPER_INLINE bool read_bits(uint8_t count, uint64_t &value) {
+            if (buffered_bits < count) {
+                if (count > 56 || remaining_bits() < count) {
+                    return false;
+                }
+                refill();
+            }
+            value = buffer & ((uint64_t{1} << count) - 1);
+            buffer >>= count;
+            buffered_bits -= count;
+            consumed_bits += count;
+            return true;
+        }
+
+        bool skip(size_t count) {
+            if (remaining_bits() < count) {
+                return false;
+            }
+            consumed_bits += count;
+            byte_position = consumed_bits / 8;
+            buffer = 0x0;
+            buffered_bits = 0;
+            uint8_t partial = consumed_bits % 8;
+            if (partial != 0) {
+                refill();
+                buffer >>= partial;
+                buffered_bits -= partial;
+            }
+            return true;
+        }
+
+        size_t bit_position() const { return consumed_bits; };
+        size_t remaining_bits() const { return size * 8 - consumed_bits; };
+
+    private:
+        // Tops the buffer up to at least 56 bits, or to the end of the data
+        REGISTER_HELPER_INLINE void refill() {
+            if (byte_position + 8 <= size) {
+                buffer |= register_detail::load_le64(data + byte_position) << buffered_bits;
+                byte_position += (63 - buffered_bits) / 8;
+                buffered_bits |= 56;
+                return;
+            }
+            while (buffered_bits <= 56 && byte_position < size) {
+                buffer |= static_cast<uint64_t>(data[byte_position++]) << buffered_bits;
+                buffered_bits += 8;
+            }
+        }
+
+        const uint8_t *data;
+        size_t size;
+        size_t byte_position = 0;
+        size_t consumed_bits = 0;
+        uint64_t buffer = 0x0;
+        uint8_t buffered_bits = 0;
+};
+
+// Packs registers back to back at arbitrary bit offsets, least significant bit
+// first. Call flush() once done to write out the final partial byte.
+class register_bit_writer {
+    public:
+        register_bit_writer(uint8_t *bytes, size_t byte_count) : data(bytes), size(byte_count) {}
+
+        template <typename REGISTER>
+        REGISTER_HELPER_INLINE bool write(const REGISTER &reg) {
+            return write_bits(reg.get_register_value(), REGISTER::register_width);
+        }
+
+        // COUNT can be at most 32 bits, bits of value above COUNT are ignored
+        REGISTER_HELPER_INLINE bool write_bits(uint64_t value, uint8_t count) {
+            if (count > 32 || remaining_bits() < count) {
+                return false;
+            }
+            buffer |= (value & ((uint64_t{1} << count) - 1)) << buffered_bits;
+            buffered_bits += count;
+            written_bits += count;
+            if (buffered_bits >= 32 && byte_position + 4 <= size) {
+                register_detail::store_le32(data + byte_position, static_cast<uint32_t>(buffer));
+                byte_position += 4;
+                buffer >>= 32;
+                buffered_bits -= 32;
+            }
+            return true;
+        }
+
+        // Writes out any buffered bits, returns the number of bytes used
+        size_t flush() {
+            while (buffered_bits > 0) {
+                data[byte_position++] = static_cast<uint8_t>(buffer);
+                buffer >>= 8;
+                buffered_bits = buffered_bits > 8 ? buffered_bits - 8 : 0;
+            }
+            return byte_position;
+        }
+
+        size_t bit_position() const { return written_bits; };
+        size_t remaining_bits() const { return size * 8 - written_bits; };
+
+    private:
+        uint8_t *data;
+        size_t size;
+        size_t byte_position = 0;
+        size_t written_bits = 0;
+        uint64_t buffer = 0x0;
+        uint8_t buffered_bits = 0;
+};
+
+namespace register_detail {
+    // Shared by every register type, these only see the field table and the
+    // raw value widened to 64 bits
+    REGISTER_HELPER_COLD const register_field_info *find_field_info(
+        const register_field_info *fields, size_t field_count, const char *name) {
+        for (size_t i = 0; i < field_count; i++) {
+            if (field_names_equal(fields[i].name, name)) {
+                return &fields[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Inlined into format_fields so the whole formatter stays in the cold section
+    REGISTER_HELPER_INLINE void append_char(char *buffer, size_t size, size_t &length, char c) {
+        if (length + 1 < size) {
+            buffer[length] = c;
+        }
+        length++;
+    }
+
+    REGISTER_HELPER_COLD size_t format_fields(
+        const register_field_info *fields, size_t field_count, uint64_t value, char *buffer, size_t size) {
+        static const char digits[] = "0123456789abcdef";
+        size_t length = 0;
+        for (size_t i = 0; i < field_count; i++) {
+            if (i != 0) {
+                append_char(buffer, size, length, ' ');
+            }
+            for (const char *c = fields[i].name; *c != '\0'; c++) {
+                append_char(buffer, size, length, *c);
+            }
+            append_char(buffer, size, length, '=');
+            append_char(buffer, size, length, '0');
+            append_char(buffer, size, length, 'x');
+            uint64_t field = (value & field_mask(fields[i])) >> fields[i].start;
+            int shift = (fields[i].end - fields[i].start) / 4 * 4;
+            for (; shift >= 0; shift -= 4) {
+                append_char(buffer, size, length, digits[(field >> shift) & 0xF]);
+            }
+        }
+        if (size != 0) {
+            buffer[length < size ? length : size - 1] = '\0';
+        }
+        return length;
+    }
+
+    template <typename REGISTER>
+    constexpr uint64_t declared_field_mask() {
+        uint64_t mask = 0x0;
+        for (size_t i = 0; i < REGISTER::field_count; i++) {
+            mask |= field_mask(REGISTER::fields[i]);
+        }
+        return mask;
+    }
+}
+
+namespace register_detail {
+    // Deliberately not constexpr, reaching it during constant evaluation makes
+    // the compiler report the bad field name
+    inline void field_not_found() {}
+}
+
+// Looks a field up by name at compile time for APIs that take a field rather
+// than calling its accessor. Use it in a constexpr context so a misspelled name
+// is a compile error, at runtime an unknown name yields an empty field.
+//
+//   constexpr register_field_info port_number = register_field<link_capabilites_register>("port_number");
+template <typename REGISTER>
+constexpr register_field_info register_field(const char *name) {
+    size_t index = register_detail::find_field<REGISTER>(name);
+    if (index == REGISTER::field_count) {
+        register_detail::field_not_found();
+        return register_field_info{nullptr, 0, 0, REGISTER_PERMS::NONE};
+    }
+    return REGISTER::fields[index];
+}
+
+// Extracts a field from a raw value without going through the named accessor
+template <typename RAW>
+REGISTER_HELPER_INLINE constexpr RAW get_field_value(RAW raw, const register_field_info &field) {
+    return static_cast<RAW>((static_cast<uint64_t>(raw) & register_detail::field_mask(field)) >> field.start);
+}
+
+// Writes "field=0x.. field=0x.." into buffer, always NUL terminated. Returns
+// the full length, which is larger than size - 1 if the output was truncated.
+template <typename REGISTER>
+inline size_t format_register(const REGISTER &reg, char *buffer, size_t size) {
+    return register_detail::format_fields(REGISTER::fields, REGISTER::field_count,
+        reg.get_register_value(), buffer, size);
+}
+
+// Looks a field up by a name only known at runtime, returns false if the
+// register has no such field
+template <typename REGISTER>
+inline bool get_register_field(const REGISTER &reg, const char *name, uint64_t &value) {
+    const register_field_info *field = register_detail::find_field_info(REGISTER::fields, REGISTER::field_count, name);
+    if (field == nullptr) {
+        return false;
+    }
+    value = (static_cast<uint64_t>(reg.get_register_value()) & register_detail::field_mask(*field)) >> field->start;
+    return true;
+}
+
+// Returns the bits that are set outside of every declared field, a non zero
+// result usually means a reserved bit was written
+template <typename REGISTER>
+REGISTER_HELPER_INLINE typename REGISTER::raw_type get_reserved_bits(const REGISTER &reg) {
+    constexpr uint64_t declared = register_detail::declared_field_mask<REGISTER>();
+    return static_cast<typename REGISTER::raw_type>(reg.get_register_value() & ~declared);
+}
+
+namespace register_detail {
+    constexpr uint64_t HASH_PRIME_1 = 0x9E37'79B1'85EB'CA87;
+    constexpr uint64_t HASH_PRIME_2 = 0xC2B2'AE3D'27D4'EB4F;
+
+    REGISTER_HELPER_INLINE constexpr uint64_t hash_round(uint64_t lane, uint64_t value) {
+        lane += value * HASH_PRIME_2;
+        lane = (lane << 31) | (lane >> 33);
+        return lane * HASH_PRIME_1;
+    }
+
+    REGISTER_HELPER_INLINE constexpr uint64_t hash_avalanche(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xFF51'AFD7'ED55'8CCD;
+        hash ^= hash >> 33;
+        hash *= 0xC4CE'B9FE'1A85'EC53;
+        hash ^= hash >> 33;
+        return hash;
+    }
+}
+
+// Hashes the raw values of an array of registers. Four independent lanes are
+// updated per step so the loop pipelines well and vectorises where 64 bit
+// multiplies are available. Not cryptographic, equal hashes mean equal blocks
+// with overwhelming probability, not certainty.
+template <typename REGISTER>
+REGISTER_HELPER_FLATTEN inline uint64_t register_hash(const REGISTER *regs, size_t count, uint64_t seed = 0) {
+    uint64_t lanes[4] = {
+        seed + register_detail::HASH_PRIME_1 + register_detail::HASH_PRIME_2,
+        seed + register_detail::HASH_PRIME_2,
+        seed,
+        seed - register_detail::HASH_PRIME_1
+    };
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] = register_detail::hash_round(lanes[lane], regs[i + lane].get_register_value());
+        }
+    }
+    for (; i < count; i++) {
+        lanes[i % 4] = register_detail::hash_round(lanes[i % 4], regs[i].get_register_value());
+    }
+    uint64_t hash = count * REGISTER::register_width;
+    for (uint64_t lane : lanes) {
+        hash = register_detail::hash_round(hash, lane);
+    }
+    return register_detail::hash_avalanche(hash);
+}
+
+namespace register_detail {
+    // Castagnoli polynomial, bit reversed
+    constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F6'3B78;
+
+    struct crc32c_table {
+        uint32_t entries[256];
+    };
+
+    constexpr crc32c_table make_crc32c_table() {
+        crc32c_table table = {};
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+            }
+            table.entries[byte] = crc;
+        }
+        return table;
+    }
+
+    constexpr crc32c_table crc32c_table_v = make_crc32c_table();
+
+    // Feeds one raw value to the CRC, least significant byte first, with no
+    // pre or post inversion
+    template <typename RAW>
+    REGISTER_HELPER_INLINE uint32_t crc32c_update(uint32_t crc, RAW value) {
+#if defined(__SSE4_2__)
+        return sizeof(RAW) == 2 ? __builtin_ia32_crc32hi(crc, static_cast<uint16_t>(value)) :
+            __builtin_ia32_crc32si(crc, static_cast<uint32_t>(value));
+#elif defined(__ARM_FEATURE_CRC32)
+        return sizeof(RAW) == 2 ? __crc32ch(crc, static_cast<uint16_t>(value)) : __crc32cw(crc, static_cast<uint32_t>(value));
+#else
+        for (size_t byte = 0; byte < sizeof(RAW); byte++) {
+            crc = (crc >> 8) ^ crc32c_table_v.entries[(crc ^ (value >> (byte * 8))) & 0xFF];
+        }
+        return crc;
+#endif
+    }
+
+    // a * b modulo the polynomial, both bit reversed. Branch free, since the
+    // bits of a are data and would mispredict.
+    constexpr uint32_t crc32c_multiply(uint32_t a, uint32_t b) {
+        uint32_t product = 0;
+        for (int bit = 31; bit >= 0; bit--) {
+            product ^= b & (0u - ((a >> bit) & 1));
+            b = (b >> 1) ^ (CRC32C_POLYNOMIAL & (0u - (b & 1)));
+        }
+        return product;
+    }
+
+    // CRC of value followed by the zero bytes factor stands for. With PCLMUL
+    // the product is one carry-less multiply reduced by the crc32 instruction,
+    // which also supplies the x^32 a CRC multiplies by.
+    template <typename RAW>
+    REGISTER_HELPER_INLINE uint32_t crc32c_shifted(RAW value, uint32_t factor) {
+#if defined(__SSE4_2__) && defined(__PCLMUL__) && defined(__x86_64__)
+        typedef long long lanes __attribute__((vector_size(16)));
+        uint32_t aligned = static_cast<uint32_t>(value) << (32 - 8 * sizeof(RAW));
+        lanes product = __builtin_ia32_pclmulqdq128(lanes{static_cast<long long>(aligned), 0},
+            lanes{static_cast<long long>(factor), 0}, 0x00);
+        return static_cast<uint32_t>(__builtin_ia32_crc32di(0, static_cast<uint64_t>(product[0]) << 1));
+#else
+        return crc32c_multiply(crc32c_update(uint32_t{0}, value), factor);
+#endif
+    }
+
+    // x^(8 * bytes) modulo the polynomial, appending that many zero bytes to
+    // a message multiplies its CRC by this
+    constexpr uint32_t crc32c_zeros_factor(size_t bytes) {
+        uint32_t factor = uint32_t{1} << 31;
+        uint32_t square = uint32_t{1} << 23;
+        for (; bytes != 0; bytes >>= 1) {
+            if (bytes & 1) {
+                factor = crc32c_multiply(factor, square);
+            }
+            square = crc32c_multiply(square, square);
+        }
+        return factor;
+    }
+}
+
+// CRC32C of the raw values of an array of registers, each fed least
+// significant byte first. Uses the SSE4.2 or ARMv8 CRC instructions when the
+// target has them and a table otherwise, with the same result either way.
+// Pass a previous result as crc to continue over a following array.
+template <typename REGISTER>
+REGISTER_HELPER_FLATTEN inline uint32_t register_crc32c(const REGISTER *regs, size_t count, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < count; i++) {
+        crc = register_detail::crc32c_update(crc, regs[i].get_register_value());
+    }
+    return ~crc;
+}
+
+// A fixed block of COUNT registers that keeps its register_crc32c()
+// fingerprint current as registers are written. A write only costs the CRC of
+// the changed bits shifted to their position, so monitoring can tell whether a
+// device's configuration changed with a single 32 bit compare.
+template <typename REGISTER, size_t COUNT>
+class register_fingerprinted_block {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        register_fingerprinted_block() : crc(register_crc32c(regs, COUNT)) {}
+
+        REGISTER_HELPER_INLINE const REGISTER &operator[](size_t index) const { return regs[index]; };
+        REGISTER_HELPER_INLINE const REGISTER *data() const { return regs; };
+        REGISTER_HELPER_INLINE static constexpr size_t size() { return COUNT; };
+        REGISTER_HELPER_INLINE uint32_t fingerprint() const { return crc; };
+
+        void set(size_t index, const REGISTER &reg) {
+            raw_type difference = regs[index].get_register_value() ^ reg.get_register_value();
+            if (difference != 0) {
+                // For messages of equal length the CRC of their XOR is the XOR
+                // of their CRCs, so only the difference needs hashing
+                crc ^= register_detail::crc32c_shifted(difference, positions.factors[index]);
+                regs[index] = reg;
+            }
+        }
+
+    private:
+        struct position_factors {
+            uint32_t factors[COUNT];
+        };
+
+        static constexpr position_factors make_position_factors() {
+            position_factors result = {};
+            for (size_t index = 0; index < COUNT; index++) {
+                result.factors[index] = register_detail::crc32c_zeros_factor((COUNT - 1 - index) * sizeof(raw_type));
+            }
+            return result;
+        }
+
+        static constexpr position_factors positions = make_position_factors();
+
+        REGISTER regs[COUNT];
+        uint32_t crc;
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h for placing register data and
+// the threads that poll it on a device's NUMA node, and for backing large
+// arrays with huge pages. Linux only. Uses libnuma for allocation when
+// REGISTER_HELPER_USE_LIBNUMA is defined (link with -lnuma) and the system
+// supports NUMA, the mbind system call otherwise.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(REGISTER_HELPER_USE_LIBNUMA)
+#include <numa.h>
+#endif
+#include "jacobs_register_helper.h"
+
+namespace register_detail {
+    // MPOL_PREFERRED from <linux/mempolicy.h>, places pages on the node while
+    // it has memory and falls back to other nodes after
+    constexpr int NUMA_POLICY_PREFERRED = 1;
+
+    constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+
+    // Best effort, without the policy the pages still work, only from
+    // whichever node first touches them
+    inline void prefer_numa_node(void *memory, size_t bytes, int node) {
+        if (node < 0) {
+            return;
+        }
+        std::vector<unsigned long> mask(node / (8 * sizeof(unsigned long)) + 1, 0);
+        mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+        syscall(SYS_mbind, memory, bytes, NUMA_POLICY_PREFERRED, mask.data(),
+            mask.size() * 8 * sizeof(unsigned long) + 1, 0);
+    }
+
+    inline bool read_first_line(const std::string &path, std::string &line) {
+        FILE *file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char buffer[4096];
+        bool read = std::fgets(buffer, sizeof(buffer), file) != nullptr;
+        std::fclose(file);
+        if (read) {
+            line = buffer;
+            while (!line.empty() && (line.back() == '\n' || line.back() == ' ')) {
+                line.pop_back();
+            }
+        }
+        return read;
+    }
+}
+
+// NUMA node a PCI device is attached to, such as "0000:3b:00.0", read from
+// <sysfs_root>/bus/pci/devices/<address>/numa_node. Returns -1 when the
+// device is unknown or the platform doesn't report a node. sysfs_root lets the
+// lookup run against a copy of the tree.
+inline int register_device_numa_node(const char *pci_address, const char *sysfs_root = "/sys") {
+    std::string line;
+    if (!register_detail::read_first_line(std::string(sysfs_root) + "/bus/pci/devices/" + pci_address + "/numa_node", line)) {
+        return -1;
+    }
+    char *end = nullptr;
+    long node = std::strtol(line.c_str(), &end, 10);
+    return end == line.c_str() || node < 0 ? -1 : static_cast<int>(node);
+}
+
+// CPUs of a NUMA node, parsed from the "0-3,8-11" list in
+// <sysfs_root>/devices/system/node/node<N>/cpulist. Empty if unknown.
+inline std::vector<int> register_numa_node_cpus(int node, const char *sysfs_root = "/sys") {
+    std::vector<int> cpus;
+    std::string line;
+    if (node < 0 || !register_detail::read_first_line(std::string(sysfs_root) + "/devices/system/node/node" +
+        std::to_string(node) + "/cpulist", line)) {
+        return cpus;
+    }
+    const char *position = line.c_str();
+    while (*position != '\0') {
+        char *end = nullptr;
+        long first = std::strtol(position, &end, 10);
+        if (end == position) {
+            return std::vector<int>();
+        }
+        long last = first;
+        position = end;
+        if (*position == '-') {
+            last = std::strtol(position + 1, &end, 10);
+            if (end == position + 1 || last < first) {
+                return std::vector<int>();
+            }
+            position = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*position == ',') {
+            position++;
+        }
+    }
+    return cpus;
+}
+
+// Restricts the calling thread to the CPUs of node, so a device's poller runs
+// next to the device and its memory. Returns false if the node's CPUs are
+// unknown or the affinity can't be set.
+inline bool register_pin_thread_to_node(int node, const char *sysfs_root = "/sys") {
+    std::vector<int> cpus = register_numa_node_cpus(node, sysfs_root);
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// Memory resource whose pages are placed on one NUMA node. Every allocation
+// maps whole pages, so use it as the upstream of a
+// std::pmr::monotonic_buffer_resource or pool rather than directly for small
+// objects:
+//
+//   register_numa_resource node_memory(register_device_numa_node("0000:3b:00.0"));
+//   std::pmr::monotonic_buffer_resource arena(&node_memory);
+//   register_snapshot_store<link_capabilites_register> snapshots(&arena);
+//
+// A node of -1 leaves placement to the kernel.
+class register_numa_resource : public std::pmr::memory_resource {
+    public:
+        explicit register_numa_resource(int node) : node(node) {}
+
+        int numa_node() const { return node; };
+
+    private:
+        // Zero byte requests still get a page, mmap refuses length 0
+        static size_t mapped_size(size_t bytes) {
+            return bytes == 0 ? static_cast<size_t>(sysconf(_SC_PAGESIZE)) : bytes;
+        }
+
+        // libnuma's other calls are undefined when numa_available() fails,
+        // such as on a kernel without NUMA support, so then this falls back
+        // to mmap too
+        static bool use_libnuma() {
+#if defined(REGISTER_HELPER_USE_LIBNUMA)
+            static const bool available = numa_available() >= 0;
+            return available;
+#else
+            return false;
+#endif
+        }
+
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            if (alignment > static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+                throw std::bad_alloc();
+            }
+            size_t size = mapped_size(bytes);
+#if defined(REGISTER_HELPER_USE_LIBNUMA)
+            if (use_libnuma()) {
+                void *memory = node >= 0 ? numa_alloc_onnode(size, node) : numa_alloc_local(size);
+                if (memory == nullptr) {
+                    throw std::bad_alloc();
+                }
+                return memory;
+            }
+#endif
+            void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            register_detail::prefer_numa_node(memory, size, node);
+            return memory;
+        }
+
+        void do_deallocate(void *memory, size_t bytes, size_t) override {
+#if defined(REGISTER_HELPER_USE_LIBNUMA)
+            if (use_libnuma()) {
+                numa_free(memory, mapped_size(bytes));
+                return;
+            }
+#endif
+            munmap(memory, mapped_size(bytes));
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+        int node;
+};
+
+// Memory resource backed by 2 MB pages, for register arrays of hundreds of MB
+// where 4 KB pages make TLB misses dominate scans. Tries explicit huge pages
+// (MAP_HUGETLB, needs pages reserved in /proc/sys/vm/nr_hugepages) first, then
+// falls back to a 2 MB aligned mapping with madvise(MADV_HUGEPAGE) for
+// transparent huge pages. Allocations are rounded up to 2 MB, so like
+// register_numa_resource it is meant for large blocks or as an upstream.
+// A node other than -1 also places the pages on that NUMA node.
+class register_huge_page_resource : public std::pmr::memory_resource {
+    public:
+        explicit register_huge_page_resource(int node = -1) : node(node) {}
+
+        // How many allocations got each kind of mapping
+        size_t explicit_allocations() const { return explicit_count; };
+        size_t transparent_allocations() const { return transparent_count; };
+
+    private:
+        // Zero byte requests still get a huge page, mmap refuses length 0
+        static size_t rounded(size_t bytes) {
+            if (bytes == 0) {
+                return register_detail::HUGE_PAGE_SIZE;
+            }
+            return (bytes + register_detail::HUGE_PAGE_SIZE - 1) / register_detail::HUGE_PAGE_SIZE * register_detail::HUGE_PAGE_SIZE;
+        }
+
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            if (alignment > register_detail::HUGE_PAGE_SIZE) {
+                throw std::bad_alloc();
+            }
+            size_t size = rounded(bytes);
+            void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED) {
+                explicit_count++;
+                register_detail::prefer_numa_node(memory, size, node);
+                return memory;
+            }
+            // Over map by one huge page and trim, so the range starts on a
+            // 2 MB boundary and can be covered by transparent huge pages
+            uint8_t *mapping = static_cast<uint8_t *>(mmap(nullptr, size + register_detail::HUGE_PAGE_SIZE,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (mapping == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            uintptr_t address = reinterpret_cast<uintptr_t>(mapping);
+            uint8_t *aligned = mapping + (rounded(address) - address);
+            if (aligned != mapping) {
+                munmap(mapping, aligned - mapping);
+            }
+            munmap(aligned + size, mapping + size + register_detail::HUGE_PAGE_SIZE - (aligned + size));
+            madvise(aligned, size, MADV_HUGEPAGE);
+            register_detail::prefer_numa_node(aligned, size, node);
+            transparent_count++;
+            return aligned;
+        }
+
+        void do_deallocate(void *memory, size_t bytes, size_t) override {
+            munmap(memory, rounded(bytes));
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+        int node;
+        size_t explicit_count = 0;
+        size_t transparent_count = 0;
+};
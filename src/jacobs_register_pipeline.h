@@ -0,0 +1,337 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h for ingesting streams of
+// register snapshots across several cores. Needs the standard library, threads
+// and POSIX poll() and read().
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include "jacobs_register_helper.h"
+
+// Bounded lock free queue between exactly one producer thread and one consumer
+// thread. The head and tail live on separate cache lines so the two sides
+// don't contend. close() marks the end of the stream. push() and pop() spin
+// briefly, then sleep on a condition variable until the other side moves, so
+// an idle stream costs no CPU. The lock is only taken when a side sleeps.
+template <typename T>
+class register_spsc_queue {
+    public:
+        // Capacity is rounded up to a power of two
+        explicit register_spsc_queue(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            slots.resize(size);
+            mask = size - 1;
+        }
+
+        bool try_push(const T &value) {
+            size_t position = tail.load(std::memory_order_relaxed);
+            if (position - head.load(std::memory_order_acquire) == slots.size()) {
+                return false;
+            }
+            slots[position & mask] = value;
+            tail.store(position + 1, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        bool try_pop(T &value) {
+            size_t position = head.load(std::memory_order_relaxed);
+            if (position == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = slots[position & mask];
+            head.store(position + 1, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        // Waits for room
+        void push(const T &value) {
+            for (unsigned spins = 0; !try_push(value); spins++) {
+                if (spins >= SPIN_LIMIT) {
+                    sleep_until([this] {
+                        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) != slots.size();
+                    });
+                }
+            }
+        }
+
+        // Waits for a value, returns false once the queue is closed and empty
+        bool pop(T &value) {
+            for (unsigned spins = 0; !try_pop(value); spins++) {
+                if (closed.load(std::memory_order_acquire)) {
+                    // A push may have landed between the failed pop and close
+                    return try_pop(value);
+                }
+                if (spins >= SPIN_LIMIT) {
+                    sleep_until([this] {
+                        return head.load(std::memory_order_relaxed) != tail.load(std::memory_order_acquire) ||
+                            closed.load(std::memory_order_acquire);
+                    });
+                }
+            }
+            return true;
+        }
+
+        void close() {
+            closed.store(true, std::memory_order_release);
+            wake();
+        }
+
+    private:
+        static constexpr unsigned SPIN_LIMIT = 64;
+
+        // The sleeper announces itself before checking ready, and the waker
+        // publishes its change before checking for sleepers. The fences
+        // order both, so either the sleeper sees the change or the waker
+        // sees the sleeper and notifies under the lock.
+        template <typename READY>
+        void sleep_until(READY ready) {
+            sleepers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wakeup.wait(guard, ready);
+            }
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        void wake() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_relaxed) != 0) {
+                std::lock_guard<std::mutex> guard(lock);
+                wakeup.notify_all();
+            }
+        }
+
+        std::vector<T> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        alignas(64) std::atomic<bool> closed{false};
+        std::atomic<unsigned> sleepers{0};
+        std::mutex lock;
+        std::condition_variable wakeup;
+};
+
+struct register_pipeline_stats {
+    size_t records = 0;
+    size_t batches = 0;
+    size_t bytes = 0;
+    // Bytes of an incomplete final record, which are dropped
+    size_t truncated_bytes = 0;
+    // The stream ended on a read error rather than end of file
+    bool read_error = false;
+};
+
+// Reads snapshot records from a file or pipe and passes them through three
+// more stages, each on its own thread:
+//
+//   read -> decode -> transform -> sink
+//
+// A record is registers_per_record raw REGISTER values, little endian, as
+// write_register_archive() produces. Stages hand over batches of records
+// through register_spsc_queues, and a fixed pool of batches circulates from
+// the sink back to the reader, so nothing is allocated once running.
+// transform(REGISTER *record, size_t registers) may rewrite fields or update
+// an aggregate, sink(const REGISTER *record, size_t registers) runs on the
+// calling thread. Each is only ever called from one thread. If either throws,
+// the pipeline stops and run() rethrows once its threads have finished.
+template <typename REGISTER>
+class register_snapshot_pipeline {
+    public:
+        // Throws std::invalid_argument if any of the sizes is zero
+        register_snapshot_pipeline(size_t registers_per_record, size_t records_per_batch = 256, size_t batches_in_flight = 8) :
+            registers_per_record(registers_per_record), records_per_batch(records_per_batch), batch_count(batches_in_flight) {
+            if (registers_per_record == 0 || records_per_batch == 0 || batches_in_flight == 0) {
+                throw std::invalid_argument("register_snapshot_pipeline sizes must be non zero");
+            }
+        }
+
+        template <typename TRANSFORM, typename SINK>
+        register_pipeline_stats run(int descriptor, TRANSFORM transform, SINK sink) const {
+            size_t record_bytes = registers_per_record * sizeof(raw_type);
+            std::vector<std::unique_ptr<batch>> pool;
+            stages shared(batch_count);
+            for (size_t i = 0; i < batch_count; i++) {
+                pool.push_back(std::make_unique<batch>());
+                pool.back()->bytes.resize(records_per_batch * record_bytes);
+                pool.back()->regs.resize(records_per_batch * registers_per_record);
+                shared.free_batches.push(pool.back().get());
+            }
+
+            register_pipeline_stats stats;
+            std::exception_ptr transform_error;
+            workers threads{shared};
+            threads.reader = std::thread([&] {
+                batch *current;
+                bool done = false;
+                while (!done && !shared.stopped() && shared.free_batches.pop(current)) {
+                    size_t filled = read_fully(descriptor, current->bytes.data(), current->bytes.size(), shared, stats.read_error);
+                    done = filled < current->bytes.size();
+                    stats.bytes += filled;
+                    current->records = filled / record_bytes;
+                    if (done) {
+                        stats.truncated_bytes = filled % record_bytes;
+                    }
+                    if (current->records != 0) {
+                        shared.read_batches.push(current);
+                    }
+                }
+                shared.read_batches.close();
+            });
+            threads.decoder = std::thread([&] {
+                batch *current;
+                while (!shared.stopped() && shared.read_batches.pop(current)) {
+                    decode(*current);
+                    shared.decoded_batches.push(current);
+                }
+                shared.decoded_batches.close();
+            });
+            threads.transformer = std::thread([&] {
+                try {
+                    batch *current;
+                    while (!shared.stopped() && shared.decoded_batches.pop(current)) {
+                        for (size_t record = 0; record < current->records; record++) {
+                            transform(current->regs.data() + record * registers_per_record, registers_per_record);
+                        }
+                        shared.transformed_batches.push(current);
+                    }
+                } catch (...) {
+                    transform_error = std::current_exception();
+                    shared.stop();
+                }
+                shared.transformed_batches.close();
+            });
+
+            batch *current;
+            while (shared.transformed_batches.pop(current)) {
+                for (size_t record = 0; record < current->records; record++) {
+                    sink(static_cast<const REGISTER *>(current->regs.data() + record * registers_per_record), registers_per_record);
+                }
+                stats.records += current->records;
+                stats.batches++;
+                shared.free_batches.push(current);
+            }
+            shared.free_batches.close();
+            threads.join();
+            if (transform_error) {
+                std::rethrow_exception(transform_error);
+            }
+            return stats;
+        }
+
+    private:
+        using raw_type = typename REGISTER::raw_type;
+
+        // How long the reader waits for input before checking whether the
+        // pipeline is stopping
+        static constexpr int STOP_POLL_MILLISECONDS = 50;
+
+        struct batch {
+            std::vector<uint8_t> bytes;
+            std::vector<REGISTER> regs;
+            size_t records = 0;
+        };
+
+        // The queues between the stages. Every queue has room for the whole
+        // pool, so a push never waits.
+        struct stages {
+            explicit stages(size_t capacity) :
+                free_batches(capacity), read_batches(capacity), decoded_batches(capacity), transformed_batches(capacity) {}
+
+            bool stopped() const { return stopping.load(std::memory_order_acquire); };
+
+            // Ends every stage early and wakes any that are waiting
+            void stop() {
+                stopping.store(true, std::memory_order_release);
+                free_batches.close();
+                read_batches.close();
+                decoded_batches.close();
+                transformed_batches.close();
+            }
+
+            register_spsc_queue<batch *> free_batches;
+            register_spsc_queue<batch *> read_batches;
+            register_spsc_queue<batch *> decoded_batches;
+            register_spsc_queue<batch *> transformed_batches;
+            std::atomic<bool> stopping{false};
+        };
+
+        // Joins the stage threads when run() returns, and stops them first if
+        // it is leaving early, such as when sink throws
+        struct workers {
+            stages &shared;
+            std::thread reader;
+            std::thread decoder;
+            std::thread transformer;
+
+            ~workers() {
+                if (reader.joinable() || decoder.joinable() || transformer.joinable()) {
+                    shared.stop();
+                    join();
+                }
+            }
+
+            void join() {
+                for (std::thread *thread : {&reader, &decoder, &transformer}) {
+                    if (thread->joinable()) {
+                        thread->join();
+                    }
+                }
+            }
+        };
+
+        // Reads until size bytes arrived, the stream ended or the pipeline is
+        // stopping. Pipes deliver in pieces, and are polled so a quiet one
+        // doesn't hold up a stop.
+        static size_t read_fully(int descriptor, uint8_t *buffer, size_t size, const stages &shared, bool &error) {
+            size_t filled = 0;
+            while (filled < size && !shared.stopped()) {
+                pollfd ready{descriptor, POLLIN, 0};
+                int polled = poll(&ready, 1, STOP_POLL_MILLISECONDS);
+                if (polled == 0 || (polled < 0 && errno == EINTR)) {
+                    continue;
+                }
+                ssize_t result = read(descriptor, buffer + filled, size - filled);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result <= 0) {
+                    error = result < 0;
+                    break;
+                }
+                filled += static_cast<size_t>(result);
+            }
+            return filled;
+        }
+
+        void decode(batch &current) const {
+            const uint8_t *bytes = current.bytes.data();
+            size_t count = current.records * registers_per_record;
+            for (size_t i = 0; i < count; i++) {
+                raw_type raw = 0;
+                for (size_t byte = 0; byte < sizeof(raw_type); byte++) {
+                    raw |= static_cast<raw_type>(bytes[i * sizeof(raw_type) + byte] << (byte * 8));
+                }
+                current.regs[i].set_register_value(raw);
+            }
+        }
+
+        size_t registers_per_record;
+        size_t records_per_batch;
+        size_t batch_count;
+};
@@ -0,0 +1,579 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h for filtering large archives of
+// raw register values, needs the standard library, threads and POSIX mmap
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "jacobs_register_helper.h"
+
+enum class REGISTER_QUERY_OP {
+    NONE,
+    RANGE,
+    AND,
+    OR
+};
+
+// One instruction of a compiled predicate. RANGE pushes a mask of the rows
+// where low <= field <= high, NONE pushes an empty mask, AND and OR combine
+// the two masks on top of the stack.
+struct register_query_step {
+    REGISTER_QUERY_OP op;
+    uint8_t shift;
+    uint32_t mask;
+    uint32_t low;
+    uint32_t span;
+};
+
+// A filter over named fields, built with field_equal(), field_less(),
+// field_between() and field_in() and combined with & and |. The expression is
+// kept as a postfix program of register_query_steps. An empty predicate
+// matches every row.
+class register_predicate {
+    public:
+        register_predicate operator&(const register_predicate &other) const {
+            return combine(other, REGISTER_QUERY_OP::AND);
+        }
+
+        register_predicate operator|(const register_predicate &other) const {
+            return combine(other, REGISTER_QUERY_OP::OR);
+        }
+
+        const std::vector<register_query_step> &steps() const { return program; };
+
+        // Number of masks live at once while evaluating
+        size_t depth() const { return std::max<size_t>(max_depth, 1); };
+
+        static register_predicate range(const register_field_info &field, uint32_t low, uint32_t high) {
+            register_predicate predicate;
+            if (low > high) {
+                predicate.program.push_back(register_query_step{REGISTER_QUERY_OP::NONE, 0, 0x0, 0, 0});
+            } else {
+                uint32_t mask = static_cast<uint32_t>(register_detail::field_mask(field) >> field.start);
+                predicate.program.push_back(register_query_step{REGISTER_QUERY_OP::RANGE, field.start, mask, low, high - low});
+            }
+            predicate.max_depth = 1;
+            return predicate;
+        }
+
+    private:
+        register_predicate combine(const register_predicate &other, REGISTER_QUERY_OP op) const {
+            if (program.empty() || other.program.empty()) {
+                // Anything AND everything is itself, anything OR everything is everything
+                return op == REGISTER_QUERY_OP::AND ? (program.empty() ? other : *this) : register_predicate();
+            }
+            register_predicate predicate;
+            predicate.program = program;
+            predicate.program.insert(predicate.program.end(), other.program.begin(), other.program.end());
+            predicate.program.push_back(register_query_step{op, 0, 0x0, 0, 0});
+            predicate.max_depth = std::max(max_depth, other.max_depth + 1);
+            return predicate;
+        }
+
+        std::vector<register_query_step> program;
+        size_t max_depth = 0;
+};
+
+inline register_predicate field_equal(const register_field_info &field, uint32_t value) {
+    return register_predicate::range(field, value, value);
+}
+
+inline register_predicate field_less(const register_field_info &field, uint32_t value) {
+    return value == 0 ? register_predicate::range(field, 1, 0) : register_predicate::range(field, 0, value - 1);
+}
+
+inline register_predicate field_between(const register_field_info &field, uint32_t low, uint32_t high) {
+    return register_predicate::range(field, low, high);
+}
+
+inline register_predicate field_in(const register_field_info &field, std::initializer_list<uint32_t> values) {
+    if (values.size() == 0) {
+        return register_predicate::range(field, 1, 0);
+    }
+    register_predicate predicate = field_equal(field, *values.begin());
+    for (auto value = values.begin() + 1; value != values.end(); ++value) {
+        predicate = predicate | field_equal(field, *value);
+    }
+    return predicate;
+}
+
+namespace register_detail {
+    constexpr size_t QUERY_BLOCK_SIZE = 1024;
+
+    template <typename RAW>
+    REGISTER_HELPER_INLINE void query_range_loop(const RAW *values, size_t count, uint32_t shift, uint32_t mask,
+        uint32_t low, uint32_t span, uint32_t *__restrict out) {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t value = (static_cast<uint32_t>(values[i]) >> shift) & mask;
+            out[i] = value - low <= span ? 0xFFFF'FFFF : 0x0;
+        }
+    }
+
+    // Each kernel is a branch free loop over one block so the compiler turns
+    // it into vector compares and masks. The step is passed by value since out
+    // could otherwise alias it, and full blocks get a constant trip count,
+    // which -O2's vectorizer needs as it won't add a scalar remainder loop.
+    template <typename RAW>
+    REGISTER_HELPER_INLINE void query_range_kernel(const RAW *values, size_t count, const register_query_step &step, uint32_t *out) {
+        if (count == QUERY_BLOCK_SIZE) {
+            query_range_loop(values, QUERY_BLOCK_SIZE, step.shift, step.mask, step.low, step.span, out);
+        } else {
+            query_range_loop(values, count, step.shift, step.mask, step.low, step.span, out);
+        }
+    }
+
+    // Runs the predicate over one block, stack holds depth() blocks of masks.
+    // Returns the mask of the matching rows.
+    template <typename RAW>
+    REGISTER_HELPER_FLATTEN inline const uint32_t *evaluate_block(const register_predicate &predicate, const RAW *values, size_t count, uint32_t *stack) {
+        if (predicate.steps().empty()) {
+            std::fill(stack, stack + count, 0xFFFF'FFFF);
+            return stack;
+        }
+        uint32_t *top = stack;
+        for (const register_query_step &step : predicate.steps()) {
+            switch (step.op) {
+                case REGISTER_QUERY_OP::NONE:
+                    std::fill(top, top + count, 0x0);
+                    top += QUERY_BLOCK_SIZE;
+                    break;
+                case REGISTER_QUERY_OP::RANGE:
+                    query_range_kernel(values, count, step, top);
+                    top += QUERY_BLOCK_SIZE;
+                    break;
+                case REGISTER_QUERY_OP::AND:
+                    top -= QUERY_BLOCK_SIZE;
+                    for (size_t i = 0; i < count; i++) {
+                        (top - QUERY_BLOCK_SIZE)[i] &= top[i];
+                    }
+                    break;
+                case REGISTER_QUERY_OP::OR:
+                    top -= QUERY_BLOCK_SIZE;
+                    for (size_t i = 0; i < count; i++) {
+                        (top - QUERY_BLOCK_SIZE)[i] |= top[i];
+                    }
+                    break;
+            }
+        }
+        return stack;
+    }
+}
+
+// Per field minimum and maximum, plus the OR and AND of the raw values, for
+// each chunk of QUERY_BLOCK_SIZE registers in an archive. Built alongside the
+// archive as it is written, it lets register_query skip chunks a predicate
+// can't match, which for rarely set error flags is nearly all of them.
+template <typename REGISTER>
+class register_zone_map {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        static constexpr size_t CHUNK_SIZE = register_detail::QUERY_BLOCK_SIZE;
+
+        struct zone {
+            std::array<raw_type, REGISTER::field_count> minimum;
+            std::array<raw_type, REGISTER::field_count> maximum;
+            raw_type any_set;
+            raw_type all_set;
+            size_t count;
+        };
+
+        register_zone_map() = default;
+
+        register_zone_map(const raw_type *values, size_t count) {
+            append(values, count);
+        }
+
+        // Summarises values written after the ones already in the map
+        void append(const raw_type *values, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                append(values[i]);
+            }
+        }
+
+        void append(raw_type value) {
+            if (zones.empty() || zones.back().count == CHUNK_SIZE) {
+                zone chunk;
+                for (size_t field = 0; field < REGISTER::field_count; field++) {
+                    chunk.minimum[field] = chunk.maximum[field] = get_field_value(value, REGISTER::fields[field]);
+                }
+                chunk.any_set = chunk.all_set = value;
+                chunk.count = 1;
+                zones.push_back(chunk);
+                return;
+            }
+            zone &chunk = zones.back();
+            for (size_t field = 0; field < REGISTER::field_count; field++) {
+                raw_type field_value = get_field_value(value, REGISTER::fields[field]);
+                chunk.minimum[field] = std::min(chunk.minimum[field], field_value);
+                chunk.maximum[field] = std::max(chunk.maximum[field], field_value);
+            }
+            chunk.any_set |= value;
+            chunk.all_set &= value;
+            chunk.count++;
+        }
+
+        size_t chunk_count() const { return zones.size(); };
+        const zone &operator[](size_t chunk) const { return zones[chunk]; };
+
+        // One flag per chunk, 0 where no register in the chunk can match
+        // predicate. Steps on fields REGISTER doesn't declare never rule a
+        // chunk out.
+        std::vector<uint8_t> candidates(const register_predicate &predicate) const {
+            std::vector<uint8_t> result(zones.size(), 1);
+            if (predicate.steps().empty()) {
+                return result;
+            }
+            std::vector<size_t> step_fields;
+            for (const register_query_step &step : predicate.steps()) {
+                step_fields.push_back(find_field(step));
+            }
+            std::vector<uint8_t> stack(predicate.depth());
+            for (size_t chunk = 0; chunk < zones.size(); chunk++) {
+                size_t top = 0;
+                for (size_t i = 0; i < predicate.steps().size(); i++) {
+                    const register_query_step &step = predicate.steps()[i];
+                    switch (step.op) {
+                        case REGISTER_QUERY_OP::NONE:
+                            stack[top++] = 0;
+                            break;
+                        case REGISTER_QUERY_OP::RANGE:
+                            stack[top++] = step_fields[i] == REGISTER::field_count ||
+                                overlaps(zones[chunk], step_fields[i], step);
+                            break;
+                        case REGISTER_QUERY_OP::AND:
+                            top--;
+                            stack[top - 1] &= stack[top];
+                            break;
+                        case REGISTER_QUERY_OP::OR:
+                            top--;
+                            stack[top - 1] |= stack[top];
+                            break;
+                    }
+                }
+                result[chunk] = stack[0];
+            }
+            return result;
+        }
+
+    private:
+        // Index of the declared field the step reads, field_count if none
+        static size_t find_field(const register_query_step &step) {
+            for (size_t field = 0; field < REGISTER::field_count; field++) {
+                const register_field_info &info = REGISTER::fields[field];
+                if (info.start == step.shift && (register_detail::field_mask(info) >> info.start) == step.mask) {
+                    return field;
+                }
+            }
+            return REGISTER::field_count;
+        }
+
+        static bool overlaps(const zone &chunk, size_t field, const register_query_step &step) {
+            uint64_t high = static_cast<uint64_t>(step.low) + step.span;
+            return chunk.maximum[field] >= step.low && chunk.minimum[field] <= high;
+        }
+
+        std::vector<zone> zones;
+};
+
+// Runs predicates over an array of raw register values, such as a
+// register_mapped_archive. The array is split into contiguous ranges, one per
+// thread, and results are returned in row order. Given a zone map of the same
+// values, chunks that can't match are skipped without being read.
+template <typename REGISTER>
+class register_query {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        // threads of 0 uses every hardware thread
+        register_query(const raw_type *values, size_t count, unsigned threads = 0, const register_zone_map<REGISTER> *zones = nullptr) :
+            values(values), count(count), threads(threads != 0 ? threads : std::max(std::thread::hardware_concurrency(), 1u)), zones(zones) {}
+
+        // Number of rows matching predicate
+        size_t count_matches(const register_predicate &predicate) const {
+            std::vector<size_t> totals = scan<size_t>(predicate, [](size_t &total, size_t, const uint32_t *mask, size_t size) {
+                for (size_t i = 0; i < size; i++) {
+                    total += mask[i] & 0x1;
+                }
+            });
+            size_t total = 0;
+            for (size_t partial : totals) {
+                total += partial;
+            }
+            return total;
+        }
+
+        // Row numbers matching predicate
+        std::vector<size_t> select(const register_predicate &predicate) const {
+            return concatenate(scan<std::vector<size_t>>(predicate, [](std::vector<size_t> &rows, size_t begin, const uint32_t *mask, size_t size) {
+                for (size_t i = 0; i < size; i++) {
+                    if (mask[i] != 0) {
+                        rows.push_back(begin + i);
+                    }
+                }
+            }));
+        }
+
+        // Value of field in each row matching predicate
+        std::vector<raw_type> project(const register_predicate &predicate, const register_field_info &field) const {
+            return concatenate(scan<std::vector<raw_type>>(predicate, [this, &field](std::vector<raw_type> &projection, size_t begin, const uint32_t *mask, size_t size) {
+                for (size_t i = 0; i < size; i++) {
+                    if (mask[i] != 0) {
+                        projection.push_back(get_field_value(values[begin + i], field));
+                    }
+                }
+            }));
+        }
+
+    private:
+        // Calls sink(result, first_row, mask, size) for each block, with one
+        // result per thread
+        template <typename RESULT, typename SINK>
+        std::vector<RESULT> scan(const register_predicate &predicate, SINK sink) const {
+            constexpr size_t BLOCK = register_detail::QUERY_BLOCK_SIZE;
+            size_t blocks = (count + BLOCK - 1) / BLOCK;
+            size_t workers = std::max<size_t>(std::min<size_t>(threads, blocks), 1);
+            std::vector<RESULT> results(workers);
+            std::vector<uint8_t> candidates;
+            if (zones != nullptr) {
+                candidates = zones->candidates(predicate);
+            }
+            auto work = [&](size_t worker) {
+                std::vector<uint32_t> stack(predicate.depth() * BLOCK);
+                size_t first = blocks * worker / workers * BLOCK;
+                size_t last = std::min(count, blocks * (worker + 1) / workers * BLOCK);
+                for (size_t begin = first; begin < last; begin += BLOCK) {
+                    if (begin / BLOCK < candidates.size() && candidates[begin / BLOCK] == 0) {
+                        continue;
+                    }
+                    size_t size = std::min(BLOCK, last - begin);
+                    const uint32_t *mask = register_detail::evaluate_block(predicate, values + begin, size, stack.data());
+                    sink(results[worker], begin, mask, size);
+                }
+            };
+            std::vector<std::thread> pool;
+            for (size_t worker = 1; worker < workers; worker++) {
+                pool.emplace_back(work, worker);
+            }
+            work(0);
+            for (std::thread &thread : pool) {
+                thread.join();
+            }
+            return results;
+        }
+
+        template <typename T>
+        static std::vector<T> concatenate(std::vector<std::vector<T>> parts) {
+            if (parts.size() == 1) {
+                return std::move(parts[0]);
+            }
+            std::vector<T> result;
+            for (const std::vector<T> &part : parts) {
+                result.insert(result.end(), part.begin(), part.end());
+            }
+            return result;
+        }
+
+        const raw_type *values;
+        size_t count;
+        unsigned threads;
+        const register_zone_map<REGISTER> *zones;
+};
+
+// Archive encoding for fleets where few distinct register values repeat over
+// many rows. Keeps each distinct raw value once in a dictionary, and each row
+// as a code into it packed into as few bits as the dictionary size allows.
+// Predicates are evaluated once per dictionary entry rather than per row.
+template <typename REGISTER>
+class register_dictionary_archive {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        register_dictionary_archive(const raw_type *values, size_t count) : rows(count) {
+            std::unordered_map<raw_type, uint32_t> codes;
+            std::vector<uint32_t> row_codes(count);
+            for (size_t i = 0; i < count; i++) {
+                auto code = codes.emplace(values[i], static_cast<uint32_t>(entries.size()));
+                if (code.second) {
+                    entries.push_back(values[i]);
+                    entry_counts.push_back(0);
+                }
+                row_codes[i] = code.first->second;
+                entry_counts[code.first->second]++;
+            }
+            width = 1;
+            while (width < 32 && (size_t{1} << width) < entries.size()) {
+                width++;
+            }
+            // Codes never straddle two words, which keeps decoding to a shift
+            // and a mask
+            codes_per_word = 64 / width;
+            packed.assign((count + codes_per_word - 1) / codes_per_word, 0x0);
+            for (size_t i = 0; i < count; i++) {
+                packed[i / codes_per_word] |= static_cast<uint64_t>(row_codes[i]) << (i % codes_per_word * width);
+            }
+        }
+
+        size_t size() const { return rows; };
+        uint8_t code_width() const { return width; };
+        const std::vector<raw_type> &dictionary() const { return entries; };
+
+        size_t size_in_bytes() const {
+            return entries.size() * (sizeof(raw_type) + sizeof(size_t)) + packed.size() * sizeof(uint64_t);
+        }
+
+        uint32_t code(size_t row) const {
+            return static_cast<uint32_t>(packed[row / codes_per_word] >> (row % codes_per_word * width)) & code_mask();
+        }
+
+        raw_type value(size_t row) const { return entries[code(row)]; };
+
+        // Served from the per entry row counts, without touching the codes
+        size_t count_matches(const register_predicate &predicate) const {
+            size_t total = 0;
+            for (size_t entry : matching_entries(predicate)) {
+                total += entry_counts[entry];
+            }
+            return total;
+        }
+
+        std::vector<size_t> select(const register_predicate &predicate) const {
+            std::vector<size_t> result;
+            scan(predicate, [&result](size_t row, uint32_t) { result.push_back(row); });
+            return result;
+        }
+
+        std::vector<raw_type> project(const register_predicate &predicate, const register_field_info &field) const {
+            std::vector<raw_type> projected(entries.size());
+            for (size_t entry = 0; entry < entries.size(); entry++) {
+                projected[entry] = get_field_value(entries[entry], field);
+            }
+            std::vector<raw_type> result;
+            scan(predicate, [&](size_t, uint32_t entry) { result.push_back(projected[entry]); });
+            return result;
+        }
+
+    private:
+        uint32_t code_mask() const {
+            return static_cast<uint32_t>((uint64_t{1} << width) - 1);
+        }
+
+        std::vector<size_t> matching_entries(const register_predicate &predicate) const {
+            return register_query<REGISTER>(entries.data(), entries.size(), 1).select(predicate);
+        }
+
+        // Calls visit(row, code) for each row whose dictionary entry matches
+        template <typename VISIT>
+        void scan(const register_predicate &predicate, VISIT visit) const {
+            // Every code indexes the dictionary, so that bounds the table
+            // rather than the 2^width codes the width could express
+            std::vector<uint8_t> matches(entries.size(), 0);
+            for (size_t entry : matching_entries(predicate)) {
+                matches[entry] = 1;
+            }
+            uint32_t mask = code_mask();
+            for (size_t word = 0; word < packed.size(); word++) {
+                uint64_t codes = packed[word];
+                size_t first = word * codes_per_word;
+                size_t last = std::min(rows, first + codes_per_word);
+                for (size_t row = first; row < last; row++, codes >>= width) {
+                    uint32_t entry = static_cast<uint32_t>(codes) & mask;
+                    if (matches[entry] != 0) {
+                        visit(row, entry);
+                    }
+                }
+            }
+        }
+
+        size_t rows;
+        uint8_t width;
+        size_t codes_per_word;
+        std::vector<raw_type> entries;
+        std::vector<size_t> entry_counts;
+        std::vector<uint64_t> packed;
+};
+
+// Writes count raw register values as a flat little endian array that
+// register_mapped_archive can map back in. Returns false on any I/O error.
+template <typename REGISTER>
+inline bool write_register_archive(const char *path, const REGISTER *regs, size_t count) {
+    FILE *file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = true;
+    for (size_t i = 0; i < count && written; i++) {
+        typename REGISTER::raw_type raw = regs[i].get_register_value();
+        uint8_t bytes[sizeof(raw)];
+        for (size_t byte = 0; byte < sizeof(raw); byte++) {
+            bytes[byte] = static_cast<uint8_t>(raw >> (byte * 8));
+        }
+        written = std::fwrite(bytes, sizeof(bytes), 1, file) == 1;
+    }
+    return std::fclose(file) == 0 && written;
+}
+
+// Read only memory mapping of a file written by write_register_archive(). The
+// values are used in place, so this expects a little endian host.
+template <typename REGISTER>
+class register_mapped_archive {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        register_mapped_archive() = default;
+        register_mapped_archive(const register_mapped_archive &) = delete;
+        register_mapped_archive &operator=(const register_mapped_archive &) = delete;
+
+        ~register_mapped_archive() {
+            close();
+        }
+
+        // Returns false if the file can't be opened, mapped or isn't a whole
+        // number of registers
+        bool open(const char *path) {
+            close();
+            int descriptor = ::open(path, O_RDONLY);
+            if (descriptor < 0) {
+                return false;
+            }
+            struct stat status;
+            bool valid = fstat(descriptor, &status) == 0 && status.st_size % sizeof(raw_type) == 0;
+            if (valid && status.st_size > 0) {
+                void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if (mapping == MAP_FAILED) {
+                    valid = false;
+                } else {
+                    madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+                    mapped = mapping;
+                    mapped_size = status.st_size;
+                }
+            }
+            ::close(descriptor);
+            return valid;
+        }
+
+        void close() {
+            if (mapped != nullptr) {
+                munmap(mapped, mapped_size);
+            }
+            mapped = nullptr;
+            mapped_size = 0;
+        }
+
+        const raw_type *data() const { return static_cast<const raw_type *>(mapped); };
+        size_t size() const { return mapped_size / sizeof(raw_type); };
+
+    private:
+        void *mapped = nullptr;
+        size_t mapped_size = 0;
+};
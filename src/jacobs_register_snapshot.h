@@ -0,0 +1,123 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h, needs the standard library
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include "jacobs_register_helper.h"
+
+// One field that differs between two stored blocks
+template <typename REGISTER>
+struct register_field_change {
+    size_t index;
+    const register_field_info *field;
+    typename REGISTER::raw_type before;
+    typename REGISTER::raw_type after;
+};
+
+// Content addressed store for blocks of registers of one type. Each distinct
+// block is kept once and referred to by its hash, so snapshots of many devices
+// with identical registers cost one copy, and comparing two devices is
+// comparing two keys.
+//
+// All block storage comes from the memory resource passed at construction, so
+// a store for one report can live in a std::pmr::monotonic_buffer_resource and
+// be released in one go.
+template <typename REGISTER>
+class register_snapshot_store {
+    public:
+        using raw_type = typename REGISTER::raw_type;
+
+        explicit register_snapshot_store(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+            blocks(resource) {}
+
+        // Stores a copy of the block unless an identical one is already
+        // present, returns the key to retrieve it with. The key is the block's
+        // register_hash(), probed forward in the rare case of a collision.
+        uint64_t put(const REGISTER *regs, size_t count) {
+            uint64_t key = register_hash(regs, count);
+            while (true) {
+                auto existing = blocks.find(key);
+                if (existing == blocks.end()) {
+                    std::pmr::vector<raw_type> &block = blocks[key];
+                    block.reserve(count);
+                    for (size_t i = 0; i < count; i++) {
+                        block.push_back(regs[i].get_register_value());
+                    }
+                    stored_registers += count;
+                    return key;
+                }
+                if (matches(existing->second, regs, count)) {
+                    deduplicated_registers += count;
+                    return key;
+                }
+                key++;
+            }
+        }
+
+        // Copies the block back into regs, which must have room for as many
+        // registers as were put() under key. Returns false for unknown keys.
+        bool get(uint64_t key, REGISTER *regs) const {
+            auto block = blocks.find(key);
+            if (block == blocks.end()) {
+                return false;
+            }
+            for (size_t i = 0; i < block->second.size(); i++) {
+                regs[i].set_register_value(block->second[i]);
+            }
+            return true;
+        }
+
+        // Raw values of a stored block without copying, nullptr for unknown keys
+        const std::pmr::vector<raw_type> *find(uint64_t key) const {
+            auto block = blocks.find(key);
+            return block == blocks.end() ? nullptr : &block->second;
+        }
+
+        // Appends each field that differs between two blocks of the same size
+        // to changes, which brings its own allocator. Returns false for unknown
+        // keys or blocks of different sizes.
+        bool diff(uint64_t before_key, uint64_t after_key, std::pmr::vector<register_field_change<REGISTER>> &changes) const {
+            const std::pmr::vector<raw_type> *before = find(before_key);
+            const std::pmr::vector<raw_type> *after = find(after_key);
+            if (before == nullptr || after == nullptr || before->size() != after->size()) {
+                return false;
+            }
+            for (size_t i = 0; i < before->size(); i++) {
+                if ((*before)[i] == (*after)[i]) {
+                    continue;
+                }
+                for (const register_field_info &field : REGISTER::fields) {
+                    raw_type old_value = get_field_value((*before)[i], field);
+                    raw_type new_value = get_field_value((*after)[i], field);
+                    if (old_value != new_value) {
+                        changes.push_back(register_field_change<REGISTER>{i, &field, old_value, new_value});
+                    }
+                }
+            }
+            return true;
+        }
+
+        size_t block_count() const { return blocks.size(); };
+        size_t stored_bytes() const { return stored_registers * sizeof(raw_type); };
+        size_t deduplicated_bytes() const { return deduplicated_registers * sizeof(raw_type); };
+
+    private:
+        static bool matches(const std::pmr::vector<raw_type> &block, const REGISTER *regs, size_t count) {
+            if (block.size() != count) {
+                return false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (block[i] != regs[i].get_register_value()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::pmr::unordered_map<uint64_t, std::pmr::vector<raw_type>> blocks;
+        size_t stored_registers = 0;
+        size_t deduplicated_registers = 0;
+};
@@ -0,0 +1,543 @@
+#pragma once
+
+// Hosted companion to jacobs_register_helper.h for registers behind a bus,
+// such as sensors and retimers on I2C, SMBus or SPI, where every transaction
+// costs tens of microseconds, or in memory and MMIO, where it is one load or
+// store. Needs the standard library, the Linux backends also need i2c-dev and
+// spidev.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <linux/spi/spidev.h>
+#endif
+#include "jacobs_register_helper.h"
+
+enum class REGISTER_BYTE_ORDER {
+    LITTLE,
+    BIG
+};
+
+// A device's register space reached through bus transactions. Addresses are
+// byte offsets into the device's register map. Backends implement one block
+// transfer per transaction, read_block() and write_block() count them.
+class register_bus {
+    public:
+        virtual ~register_bus() = default;
+
+        bool read_block(uint32_t address, uint8_t *data, size_t size) {
+            transaction_count++;
+            return do_read(address, data, size);
+        }
+
+        bool write_block(uint32_t address, const uint8_t *data, size_t size) {
+            transaction_count++;
+            return do_write(address, data, size);
+        }
+
+        // Largest transfer one transaction carries, 0 if the device only
+        // accepts one register per transaction
+        virtual size_t max_block_size() const = 0;
+
+        // Whether one transaction can carry size bytes starting at address.
+        // Buses with alignment rules, such as MMIO, narrow this further.
+        virtual bool accepts_block(uint32_t address, size_t size) const {
+            (void)address;
+            return size <= max_block_size();
+        }
+
+        // Byte order of multi byte registers on the wire
+        virtual REGISTER_BYTE_ORDER byte_order() const { return REGISTER_BYTE_ORDER::LITTLE; };
+
+        size_t transactions() const { return transaction_count; };
+
+    private:
+        virtual bool do_read(uint32_t address, uint8_t *data, size_t size) = 0;
+        virtual bool do_write(uint32_t address, const uint8_t *data, size_t size) = 0;
+
+        size_t transaction_count = 0;
+};
+
+namespace register_detail {
+    inline uint64_t bus_bytes_to_raw(const uint8_t *bytes, size_t size, REGISTER_BYTE_ORDER order) {
+        uint64_t raw = 0;
+        for (size_t byte = 0; byte < size; byte++) {
+            size_t shift = order == REGISTER_BYTE_ORDER::LITTLE ? byte : size - 1 - byte;
+            raw |= static_cast<uint64_t>(bytes[byte]) << (shift * 8);
+        }
+        return raw;
+    }
+
+    inline void raw_to_bus_bytes(uint64_t raw, uint8_t *bytes, size_t size, REGISTER_BYTE_ORDER order) {
+        for (size_t byte = 0; byte < size; byte++) {
+            size_t shift = order == REGISTER_BYTE_ORDER::LITTLE ? byte : size - 1 - byte;
+            bytes[byte] = static_cast<uint8_t>(raw >> (shift * 8));
+        }
+    }
+}
+
+// Queues register reads and writes and runs them in order, merging each run
+// of reads, or of writes, to consecutive addresses into one block transfer of
+// up to the bus's max_block_size(), as long as the bus accepts_block() it.
+// Accesses are never reordered, so a write followed by a read of the same
+// register behaves as it would unbatched.
+class register_transaction_batch {
+    public:
+        explicit register_transaction_batch(register_bus &bus) : bus(bus) {}
+
+        // reg is filled in by execute()
+        template <typename REGISTER>
+        void read(uint32_t address, REGISTER &reg) {
+            accesses.push_back(access{false, address, sizeof(typename REGISTER::raw_type), &reg, 0, [](void *target, uint64_t raw) {
+                static_cast<REGISTER *>(target)->set_register_value(static_cast<typename REGISTER::raw_type>(raw));
+            }});
+        }
+
+        // The value is taken now, later changes to reg aren't written
+        template <typename REGISTER>
+        void write(uint32_t address, const REGISTER &reg) {
+            accesses.push_back(access{true, address, sizeof(typename REGISTER::raw_type), nullptr, reg.get_register_value(), nullptr});
+        }
+
+        size_t pending() const { return accesses.size(); };
+
+        // Runs and clears the queue. Stops at the first failed transaction and
+        // returns false, later accesses are dropped.
+        bool execute() {
+            size_t max_block = bus.max_block_size();
+            bool succeeded = true;
+            for (size_t first = 0; first < accesses.size() && succeeded;) {
+                // Take the longest accepted prefix of the run, sizes in between
+                // may not be, such as 6 bytes of 16 bit registers on MMIO
+                size_t last = first + 1;
+                size_t size = accesses[first].size;
+                size_t accepted_last = last;
+                size_t accepted_size = size;
+                while (last < accesses.size() && accesses[last].write == accesses[first].write &&
+                    accesses[last].address == accesses[last - 1].address + accesses[last - 1].size &&
+                    size + accesses[last].size <= max_block) {
+                    size += accesses[last].size;
+                    last++;
+                    if (bus.accepts_block(accesses[first].address, size)) {
+                        accepted_last = last;
+                        accepted_size = size;
+                    }
+                }
+                succeeded = transfer(first, accepted_last, accepted_size);
+                first = accepted_last;
+            }
+            accesses.clear();
+            return succeeded;
+        }
+
+    private:
+        struct access {
+            bool write;
+            uint32_t address;
+            uint8_t size;
+            void *target;
+            uint64_t value;
+            void (*store)(void *target, uint64_t raw);
+        };
+
+        bool transfer(size_t first, size_t last, size_t size) {
+            buffer.resize(size);
+            REGISTER_BYTE_ORDER order = bus.byte_order();
+            if (accesses[first].write) {
+                for (size_t i = first, offset = 0; i < last; offset += accesses[i].size, i++) {
+                    register_detail::raw_to_bus_bytes(accesses[i].value, buffer.data() + offset, accesses[i].size, order);
+                }
+                return bus.write_block(accesses[first].address, buffer.data(), size);
+            }
+            if (!bus.read_block(accesses[first].address, buffer.data(), size)) {
+                return false;
+            }
+            for (size_t i = first, offset = 0; i < last; offset += accesses[i].size, i++) {
+                accesses[i].store(accesses[i].target, register_detail::bus_bytes_to_raw(buffer.data() + offset, accesses[i].size, order));
+            }
+            return true;
+        }
+
+        register_bus &bus;
+        std::vector<access> accesses;
+        std::vector<uint8_t> buffer;
+};
+
+// Single register access, one transaction each
+template <typename REGISTER>
+inline bool register_bus_read(register_bus &bus, uint32_t address, REGISTER &reg) {
+    register_transaction_batch batch(bus);
+    batch.read(address, reg);
+    return batch.execute();
+}
+
+template <typename REGISTER>
+inline bool register_bus_write(register_bus &bus, uint32_t address, const REGISTER &reg) {
+    register_transaction_batch batch(bus);
+    batch.write(address, reg);
+    return batch.execute();
+}
+
+// In process stand in for a bus device, backed by memory. Models each
+// transaction as a fixed latency plus a per byte transfer time, and either
+// sleeps for it or only adds it to bus_time(), so code can be timed against
+// the bus without the hardware.
+class register_mock_device : public register_bus {
+    public:
+        register_mock_device(size_t register_space, size_t block_size, std::chrono::nanoseconds transaction_latency,
+            std::chrono::nanoseconds byte_time, REGISTER_BYTE_ORDER order = REGISTER_BYTE_ORDER::LITTLE, bool sleep = false) :
+            memory(register_space, 0x0), block_size(block_size), transaction_latency(transaction_latency),
+            byte_time(byte_time), order(order), sleep(sleep) {}
+
+        size_t max_block_size() const override { return block_size; };
+        REGISTER_BYTE_ORDER byte_order() const override { return order; };
+
+        // Modelled time spent on the bus so far
+        std::chrono::nanoseconds bus_time() const { return elapsed; };
+
+        // The device's register space, for setting up and checking contents
+        uint8_t *data() { return memory.data(); };
+
+    private:
+        bool do_read(uint32_t address, uint8_t *data, size_t size) override {
+            if (!transact(address, size)) {
+                return false;
+            }
+            std::memcpy(data, memory.data() + address, size);
+            return true;
+        }
+
+        bool do_write(uint32_t address, const uint8_t *data, size_t size) override {
+            if (!transact(address, size)) {
+                return false;
+            }
+            std::memcpy(memory.data() + address, data, size);
+            return true;
+        }
+
+        bool transact(uint32_t address, size_t size) {
+            // Mirrors a device that NAKs transfers it can't take
+            if (address > memory.size() || size > memory.size() - address || (block_size == 0 ? size > 4 : size > block_size)) {
+                return false;
+            }
+            std::chrono::nanoseconds cost = transaction_latency + byte_time * static_cast<long>(size);
+            elapsed += cost;
+            if (sleep) {
+                std::this_thread::sleep_for(cost);
+            }
+            return true;
+        }
+
+        std::vector<uint8_t> memory;
+        size_t block_size;
+        std::chrono::nanoseconds transaction_latency;
+        std::chrono::nanoseconds byte_time;
+        REGISTER_BYTE_ORDER order;
+        bool sleep;
+        std::chrono::nanoseconds elapsed{0};
+};
+
+// Registers in memory, either a device's MMIO window or an ordinary buffer
+// such as a captured BAR. Every transaction is one volatile load or store of
+// 1, 2, 4 or 8 bytes at a naturally aligned address, so a batch over
+// neighbouring 16 or 32 bit registers is done in 64 bit accesses. Pass a
+// max_access of 4 for devices that only accept 32 bit accesses. Larger values
+// are clamped to 8, wider loads aren't guaranteed to be a single access.
+class register_mmio_bus : public register_bus {
+    public:
+        register_mmio_bus(volatile void *base, size_t size, size_t max_access = 8) :
+            base(static_cast<volatile uint8_t *>(base)), size(size),
+            max_access(max_access < 8 ? max_access : 8) {}
+
+        size_t max_block_size() const override { return max_access; };
+
+        bool accepts_block(uint32_t address, size_t block) const override {
+            return block <= max_access && (block & (block - 1)) == 0 &&
+                reinterpret_cast<uintptr_t>(base + address) % block == 0;
+        }
+
+        // Memory holds registers in the host's byte order
+        REGISTER_BYTE_ORDER byte_order() const override {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return REGISTER_BYTE_ORDER::BIG;
+#else
+            return REGISTER_BYTE_ORDER::LITTLE;
+#endif
+        }
+
+    private:
+        bool do_read(uint32_t address, uint8_t *data, size_t block) override {
+            if (!valid(address, block)) {
+                return false;
+            }
+            switch (block) {
+                case 1: load<uint8_t>(address, data); break;
+                case 2: load<uint16_t>(address, data); break;
+                case 4: load<uint32_t>(address, data); break;
+                case 8: load<uint64_t>(address, data); break;
+                default: return false;
+            }
+            return true;
+        }
+
+        bool do_write(uint32_t address, const uint8_t *data, size_t block) override {
+            if (!valid(address, block)) {
+                return false;
+            }
+            switch (block) {
+                case 1: store<uint8_t>(address, data); break;
+                case 2: store<uint16_t>(address, data); break;
+                case 4: store<uint32_t>(address, data); break;
+                case 8: store<uint64_t>(address, data); break;
+                default: return false;
+            }
+            return true;
+        }
+
+        bool valid(uint32_t address, size_t block) const {
+            return accepts_block(address, block) && address <= size && block <= size - address;
+        }
+
+        template <typename WORD>
+        void load(uint32_t address, uint8_t *data) const {
+            WORD word = *reinterpret_cast<const volatile WORD *>(base + address);
+            std::memcpy(data, &word, sizeof(word));
+        }
+
+        template <typename WORD>
+        void store(uint32_t address, const uint8_t *data) {
+            WORD word;
+            std::memcpy(&word, data, sizeof(word));
+            *reinterpret_cast<volatile WORD *>(base + address) = word;
+        }
+
+        volatile uint8_t *base;
+        size_t size;
+        size_t max_access;
+};
+
+#if defined(__linux__)
+enum class REGISTER_I2C_MODE {
+    // Plain I2C through I2C_RDWR, a register address write then a read with
+    // a repeated start, blocks up to the configured size
+    I2C,
+    // SMBus I2C block transfers, for adapters without raw I2C, at most 32
+    // bytes a transaction
+    SMBUS
+};
+
+// Device behind /dev/i2c-N with 8 bit register addresses. Transfers that would
+// run past register 0xFF are refused rather than wrapped.
+class register_i2c_bus : public register_bus {
+    public:
+        register_i2c_bus() = default;
+        register_i2c_bus(const register_i2c_bus &) = delete;
+        register_i2c_bus &operator=(const register_i2c_bus &) = delete;
+
+        ~register_i2c_bus() override {
+            close();
+        }
+
+        // Returns false if the adapter can't be opened or the address claimed
+        bool open(const char *adapter, uint16_t device_address, REGISTER_I2C_MODE mode = REGISTER_I2C_MODE::I2C,
+            size_t block_size = 256, REGISTER_BYTE_ORDER order = REGISTER_BYTE_ORDER::BIG) {
+            close();
+            descriptor = ::open(adapter, O_RDWR);
+            if (descriptor < 0 || ioctl(descriptor, I2C_SLAVE, static_cast<unsigned long>(device_address)) < 0) {
+                close();
+                return false;
+            }
+            address = device_address;
+            this->mode = mode;
+            this->block_size = mode == REGISTER_I2C_MODE::SMBUS && block_size > I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_BLOCK_MAX : block_size;
+            this->order = order;
+            return true;
+        }
+
+        void close() {
+            if (descriptor >= 0) {
+                ::close(descriptor);
+            }
+            descriptor = -1;
+        }
+
+        size_t max_block_size() const override { return block_size; };
+        REGISTER_BYTE_ORDER byte_order() const override { return order; };
+
+        bool accepts_block(uint32_t register_address, size_t size) const override {
+            return size <= block_size && addressable(register_address, size);
+        }
+
+    private:
+        static bool addressable(uint32_t register_address, size_t size) {
+            return register_address <= 0xFF && size <= 0x100 - register_address;
+        }
+
+        bool do_read(uint32_t register_address, uint8_t *data, size_t size) override {
+            if (!addressable(register_address, size)) {
+                return false;
+            }
+            uint8_t offset = static_cast<uint8_t>(register_address);
+            if (mode == REGISTER_I2C_MODE::SMBUS) {
+                return smbus_transfer(I2C_SMBUS_READ, offset, data, size);
+            }
+            i2c_msg messages[2] = {
+                {address, 0, 1, &offset},
+                {address, I2C_M_RD, static_cast<uint16_t>(size), data}
+            };
+            i2c_rdwr_ioctl_data transfer = {messages, 2};
+            return ioctl(descriptor, I2C_RDWR, &transfer) == 2;
+        }
+
+        bool do_write(uint32_t register_address, const uint8_t *data, size_t size) override {
+            if (!addressable(register_address, size)) {
+                return false;
+            }
+            uint8_t offset = static_cast<uint8_t>(register_address);
+            if (mode == REGISTER_I2C_MODE::SMBUS) {
+                return smbus_transfer(I2C_SMBUS_WRITE, offset, const_cast<uint8_t *>(data), size);
+            }
+            std::vector<uint8_t> message(size + 1);
+            message[0] = offset;
+            std::memcpy(message.data() + 1, data, size);
+            i2c_msg messages[1] = {{address, 0, static_cast<uint16_t>(message.size()), message.data()}};
+            i2c_rdwr_ioctl_data transfer = {messages, 1};
+            return ioctl(descriptor, I2C_RDWR, &transfer) == 1;
+        }
+
+        bool smbus_transfer(uint8_t direction, uint8_t offset, uint8_t *data, size_t size) {
+            if (size > I2C_SMBUS_BLOCK_MAX) {
+                return false;
+            }
+            i2c_smbus_data block;
+            block.block[0] = static_cast<uint8_t>(size);
+            if (direction == I2C_SMBUS_WRITE) {
+                std::memcpy(block.block + 1, data, size);
+            }
+            i2c_smbus_ioctl_data transfer = {direction, offset, I2C_SMBUS_I2C_BLOCK_DATA, &block};
+            if (ioctl(descriptor, I2C_SMBUS, &transfer) < 0) {
+                return false;
+            }
+            if (direction == I2C_SMBUS_READ) {
+                std::memcpy(data, block.block + 1, size);
+            }
+            return true;
+        }
+
+        int descriptor = -1;
+        uint16_t address = 0;
+        REGISTER_I2C_MODE mode = REGISTER_I2C_MODE::I2C;
+        size_t block_size = 0;
+        REGISTER_BYTE_ORDER order = REGISTER_BYTE_ORDER::BIG;
+};
+
+// Device behind /dev/spidevB.C addressed with one command byte, the register
+// address with read_flag set for reads, followed by the data. Block transfers
+// continue at the following addresses, as auto incrementing devices do.
+// Transfers touching an address that doesn't fit the command byte beside
+// read_flag are refused, rather than sent to a different register.
+class register_spi_bus : public register_bus {
+    public:
+        register_spi_bus() = default;
+        register_spi_bus(const register_spi_bus &) = delete;
+        register_spi_bus &operator=(const register_spi_bus &) = delete;
+
+        ~register_spi_bus() override {
+            close();
+        }
+
+        bool open(const char *device, uint32_t speed_hz, size_t block_size = 4095, uint8_t read_flag = 0x80,
+            REGISTER_BYTE_ORDER order = REGISTER_BYTE_ORDER::BIG) {
+            close();
+            descriptor = ::open(device, O_RDWR);
+            if (descriptor < 0) {
+                return false;
+            }
+            speed = speed_hz;
+            this->block_size = block_size;
+            this->read_flag = read_flag;
+            this->order = order;
+            return true;
+        }
+
+        void close() {
+            if (descriptor >= 0) {
+                ::close(descriptor);
+            }
+            descriptor = -1;
+        }
+
+        size_t max_block_size() const override { return block_size; };
+        REGISTER_BYTE_ORDER byte_order() const override { return order; };
+
+        bool accepts_block(uint32_t address, size_t size) const override {
+            return size <= block_size && addressable(address, size);
+        }
+
+    private:
+        bool addressable(uint32_t address, size_t size) const {
+            if (address > 0xFF || size > 0x100 - address) {
+                return false;
+            }
+            uint32_t last = size == 0 ? address : address + static_cast<uint32_t>(size) - 1;
+            for (uint32_t next = address; next <= last; next++) {
+                if ((next & read_flag) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool do_read(uint32_t address, uint8_t *data, size_t size) override {
+            if (!addressable(address, size)) {
+                return false;
+            }
+            transmit.assign(size + 1, 0x0);
+            transmit[0] = static_cast<uint8_t>(address) | read_flag;
+            receive.assign(size + 1, 0x0);
+            if (!transfer(size + 1)) {
+                return false;
+            }
+            std::memcpy(data, receive.data() + 1, size);
+            return true;
+        }
+
+        bool do_write(uint32_t address, const uint8_t *data, size_t size) override {
+            if (!addressable(address, size)) {
+                return false;
+            }
+            transmit.resize(size + 1);
+            transmit[0] = static_cast<uint8_t>(address);
+            std::memcpy(transmit.data() + 1, data, size);
+            receive.assign(size + 1, 0x0);
+            return transfer(size + 1);
+        }
+
+        bool transfer(size_t length) {
+            spi_ioc_transfer message;
+            std::memset(&message, 0, sizeof(message));
+            message.tx_buf = reinterpret_cast<uintptr_t>(transmit.data());
+            message.rx_buf = reinterpret_cast<uintptr_t>(receive.data());
+            message.len = static_cast<uint32_t>(length);
+            message.speed_hz = speed;
+            message.bits_per_word = 8;
+            return ioctl(descriptor, SPI_IOC_MESSAGE(1), &message) >= 0;
+        }
+
+        int descriptor = -1;
+        uint32_t speed = 0;
+        size_t block_size = 0;
+        uint8_t read_flag = 0x80;
+        REGISTER_BYTE_ORDER order = REGISTER_BYTE_ORDER::BIG;
+        std::vector<uint8_t> transmit;
+        std::vector<uint8_t> receive;
+};
+#endif